@@ -0,0 +1,126 @@
+#include "Audio_Cache.h"
+#include <cstring>
+
+namespace audio_cache
+{
+    namespace
+    {
+        constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+        inline uint64_t Mix(uint64_t h, uint64_t word)
+        {
+            h = (h ^ word) * MULTIPLIER;
+            return h ^ (h >> 29);
+        }
+        size_t EntryBytes(size_t samples)
+        {
+            return samples * sizeof(int16_t) + sizeof(Key) + 64;
+        }
+    }
+
+    uint64_t Hash(const void *data, size_t size, uint64_t seed)
+    {
+        auto *bytes = static_cast<const unsigned char *>(data);
+        uint64_t h = Mix(seed ^ MULTIPLIER, size);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            h = Mix(h, word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, bytes + i, size - i);
+        return Mix(h, tail);
+    }
+
+    size_t BlockCache::KeyHash::operator()(const Key &key) const
+    {
+        uint64_t h = Mix(key.input_hash, key.config_hash);
+        h = Mix(h, (static_cast<uint64_t>(key.object_id) << 32) | static_cast<uint32_t>(key.frame));
+        h = Mix(h, (static_cast<uint64_t>(static_cast<uint32_t>(key.milliframe)) << 32) | static_cast<uint32_t>(key.samples));
+        return static_cast<size_t>(Mix(h, static_cast<uint32_t>(key.channels)));
+    }
+
+    void BlockCache::SetBudget(size_t new_budget)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = new_budget;
+        EvictLocked();
+    }
+
+    bool BlockCache::Lookup(const Key &key, int16_t *dst, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end() || it->second->samples.size() != count)
+        {
+            misses++;
+            return false;
+        }
+        lru.splice(lru.begin(), lru, it->second);
+        memcpy(dst, it->second->samples.data(), count * sizeof(int16_t));
+        hits++;
+        return true;
+    }
+
+    void BlockCache::Insert(const Key &key, const int16_t *src, size_t count)
+    {
+        if (EntryBytes(count) > budget.load(std::memory_order_relaxed))
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end())
+        {
+            bytes -= EntryBytes(it->second->samples.size());
+            lru.erase(it->second);
+            index.erase(it);
+        }
+        // 追い出したエントリのバッファを使い回す
+        std::vector<int16_t> samples;
+        while (!lru.empty() && bytes + EntryBytes(count) > budget)
+        {
+            Entry &victim = lru.back();
+            bytes -= EntryBytes(victim.samples.size());
+            index.erase(victim.key);
+            samples = std::move(victim.samples);
+            lru.pop_back();
+        }
+        samples.assign(src, src + count);
+        lru.push_front(Entry{key, std::move(samples)});
+        index.emplace(key, lru.begin());
+        bytes += EntryBytes(count);
+    }
+
+    void BlockCache::EraseObject(uint32_t object_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = lru.begin(); it != lru.end();)
+        {
+            if (it->key.object_id != object_id)
+            {
+                ++it;
+                continue;
+            }
+            bytes -= EntryBytes(it->samples.size());
+            index.erase(it->key);
+            it = lru.erase(it);
+        }
+    }
+
+    size_t BlockCache::BytesUsed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes;
+    }
+
+    void BlockCache::EvictLocked()
+    {
+        while (!lru.empty() && bytes > budget)
+        {
+            bytes -= EntryBytes(lru.back().samples.size());
+            index.erase(lru.back().key);
+            lru.pop_back();
+        }
+    }
+}
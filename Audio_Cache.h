@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// =================================================================
+// 処理済み音声のキャッシュ
+// =================================================================
+// 同じ区間を再生し直したときにホストとの往復を省くため、出力ブロックを
+// 予算内で LRU 保持します。キーには入力と設定のハッシュが含まれるので、
+// どちらかが変われば別のエントリとして扱われます。
+namespace audio_cache
+{
+    uint64_t Hash(const void *data, size_t size, uint64_t seed = 0);
+
+    struct Key
+    {
+        uint32_t object_id;
+        int32_t frame;
+        int32_t milliframe;
+        int32_t samples;
+        int32_t channels;
+        uint64_t input_hash;
+        uint64_t config_hash; // state_b64 + プラグインパス
+
+        bool operator==(const Key &) const = default;
+    };
+
+    class BlockCache
+    {
+    public:
+        void SetBudget(size_t bytes);
+        bool Enabled() const { return budget.load(std::memory_order_relaxed) != 0; }
+
+        // ヒットした場合は dst に count 個のサンプルを書き込みます
+        bool Lookup(const Key &key, int16_t *dst, size_t count);
+        void Insert(const Key &key, const int16_t *src, size_t count);
+        void EraseObject(uint32_t object_id);
+
+        uint64_t Hits() const { return hits.load(std::memory_order_relaxed); }
+        uint64_t Misses() const { return misses.load(std::memory_order_relaxed); }
+        size_t BytesUsed();
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const;
+        };
+        struct Entry
+        {
+            Key key;
+            std::vector<int16_t> samples;
+        };
+        void EvictLocked();
+
+        std::mutex mutex;
+        std::list<Entry> lru; // 先頭が最近使われたもの
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        size_t bytes = 0;
+        std::atomic<size_t> budget = 0;
+        std::atomic<uint64_t> hits = 0;
+        std::atomic<uint64_t> misses = 0;
+    };
+}
@@ -0,0 +1,371 @@
+#include "Audio_Convert.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AUDIO_CONVERT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define AUDIO_CONVERT_X86 0
+#endif
+
+namespace audio_convert
+{
+    namespace
+    {
+        constexpr float IN_SCALE = 1.0f / 32768.0f;
+        constexpr float OUT_SCALE = 32767.0f;
+
+        // -----------------------------------------------------------------
+        // スカラー
+        // -----------------------------------------------------------------
+        inline int16_t ToShort(float x)
+        {
+            return static_cast<int16_t>(std::clamp(x, -1.0f, 1.0f) * OUT_SCALE);
+        }
+        void ShortToFloatMonoScalar(const int16_t *src, float *dst, int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+                dst[i] = static_cast<float>(src[i]) * IN_SCALE;
+        }
+        void ShortToFloatStereoScalar(const int16_t *src, float *dst_l, float *dst_r, int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+            {
+                dst_l[i] = static_cast<float>(src[i * 2]) * IN_SCALE;
+                dst_r[i] = static_cast<float>(src[i * 2 + 1]) * IN_SCALE;
+            }
+        }
+        void FloatToShortMonoScalar(const float *src, int16_t *dst, int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+                dst[i] = ToShort(src[i]);
+        }
+        void FloatToShortStereoScalar(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+            {
+                dst[i * 2] = ToShort(src_l[i]);
+                dst[i * 2 + 1] = ToShort(src_r[i]);
+            }
+        }
+        void FloatToShortDownmixScalar(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+            {
+                float l = std::clamp(src_l[i], -1.0f, 1.0f);
+                float r = std::clamp(src_r[i], -1.0f, 1.0f);
+                dst[i] = static_cast<int16_t>(((l + r) * 0.5f) * OUT_SCALE);
+            }
+        }
+        bool IsSilentScalar(const int16_t *src, size_t samples)
+        {
+            for (size_t i = 0; i < samples; ++i)
+            {
+                if (src[i] != 0)
+                    return false;
+            }
+            return true;
+        }
+
+#if AUDIO_CONVERT_X86
+        // -----------------------------------------------------------------
+        // SSE2
+        // -----------------------------------------------------------------
+        // std::clamp(x, lo, hi) と同じ比較順序: min(hi, x) -> max(lo, .)
+        TARGET_SSE2 inline __m128i ToInt32Sse2(__m128 x)
+        {
+            x = _mm_max_ps(_mm_set1_ps(-1.0f), _mm_min_ps(_mm_set1_ps(1.0f), x));
+            return _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(OUT_SCALE)));
+        }
+        TARGET_SSE2 void ShortToFloatMonoSse2(const int16_t *src, float *dst, int frames)
+        {
+            const __m128 scale = _mm_set1_ps(IN_SCALE);
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            ShortToFloatMonoScalar(src + i, dst + i, frames - i);
+        }
+        TARGET_SSE2 void ShortToFloatStereoSse2(const int16_t *src, float *dst_l, float *dst_r, int frames)
+        {
+            const __m128 scale = _mm_set1_ps(IN_SCALE);
+            int i = 0;
+            for (; i + 4 <= frames; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+                __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+                __m128i r = _mm_srai_epi32(v, 16);
+                _mm_storeu_ps(dst_l + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+                _mm_storeu_ps(dst_r + i, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+            }
+            ShortToFloatStereoScalar(src + i * 2, dst_l + i, dst_r + i, frames - i);
+        }
+        TARGET_SSE2 void FloatToShortMonoSse2(const float *src, int16_t *dst, int frames)
+        {
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m128i a = ToInt32Sse2(_mm_loadu_ps(src + i));
+                __m128i b = ToInt32Sse2(_mm_loadu_ps(src + i + 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+            }
+            FloatToShortMonoScalar(src + i, dst + i, frames - i);
+        }
+        TARGET_SSE2 void FloatToShortStereoSse2(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            int i = 0;
+            for (; i + 4 <= frames; i += 4)
+            {
+                __m128i l = ToInt32Sse2(_mm_loadu_ps(src_l + i));
+                __m128i r = ToInt32Sse2(_mm_loadu_ps(src_r + i));
+                __m128i lr = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), lr);
+            }
+            FloatToShortStereoScalar(src_l + i, src_r + i, dst + i * 2, frames - i);
+        }
+        TARGET_SSE2 void FloatToShortDownmixSse2(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+            const __m128 half = _mm_set1_ps(0.5f), scale = _mm_set1_ps(OUT_SCALE);
+            int i = 0;
+            for (; i + 4 <= frames; i += 4)
+            {
+                __m128 l = _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(src_l + i)));
+                __m128 r = _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(src_r + i)));
+                __m128i m = _mm_cvttps_epi32(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(l, r), half), scale));
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(m, m));
+            }
+            FloatToShortDownmixScalar(src_l + i, src_r + i, dst + i, frames - i);
+        }
+        TARGET_SSE2 bool IsSilentSse2(const int16_t *src, size_t samples)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            // 32 サンプルずつ OR をとり、まとめて判定する
+            for (; i + 32 <= samples; i += 32)
+            {
+                const __m128i *p = reinterpret_cast<const __m128i *>(src + i);
+                __m128i v = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+                                         _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, zero)) != 0xFFFF)
+                    return false;
+            }
+            return IsSilentScalar(src + i, samples - i);
+        }
+
+        // -----------------------------------------------------------------
+        // AVX2
+        // -----------------------------------------------------------------
+        TARGET_AVX2 inline __m256i ToInt32Avx2(__m256 x)
+        {
+            x = _mm256_max_ps(_mm256_set1_ps(-1.0f), _mm256_min_ps(_mm256_set1_ps(1.0f), x));
+            return _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(OUT_SCALE)));
+        }
+        TARGET_AVX2 void ShortToFloatMonoAvx2(const int16_t *src, float *dst, int frames)
+        {
+            const __m256 scale = _mm256_set1_ps(IN_SCALE);
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+            }
+            ShortToFloatMonoScalar(src + i, dst + i, frames - i);
+        }
+        TARGET_AVX2 void ShortToFloatStereoAvx2(const int16_t *src, float *dst_l, float *dst_r, int frames)
+        {
+            const __m256 scale = _mm256_set1_ps(IN_SCALE);
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2));
+                __m256i l = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+                __m256i r = _mm256_srai_epi32(v, 16);
+                _mm256_storeu_ps(dst_l + i, _mm256_mul_ps(_mm256_cvtepi32_ps(l), scale));
+                _mm256_storeu_ps(dst_r + i, _mm256_mul_ps(_mm256_cvtepi32_ps(r), scale));
+            }
+            ShortToFloatStereoScalar(src + i * 2, dst_l + i, dst_r + i, frames - i);
+        }
+        TARGET_AVX2 void FloatToShortMonoAvx2(const float *src, int16_t *dst, int frames)
+        {
+            int i = 0;
+            for (; i + 16 <= frames; i += 16)
+            {
+                __m256i a = ToInt32Avx2(_mm256_loadu_ps(src + i));
+                __m256i b = ToInt32Avx2(_mm256_loadu_ps(src + i + 8));
+                // packs は 128bit レーン単位なので 64bit 単位で並べ直す
+                __m256i ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), ab);
+            }
+            FloatToShortMonoSse2(src + i, dst + i, frames - i);
+        }
+        TARGET_AVX2 void FloatToShortStereoAvx2(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m256i l = ToInt32Avx2(_mm256_loadu_ps(src_l + i));
+                __m256i r = ToInt32Avx2(_mm256_loadu_ps(src_r + i));
+                // unpack / packs ともにレーン内で完結するため並べ直しは不要
+                __m256i lr = _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 2), lr);
+            }
+            FloatToShortStereoScalar(src_l + i, src_r + i, dst + i * 2, frames - i);
+        }
+        TARGET_AVX2 void FloatToShortDownmixAvx2(const float *src_l, const float *src_r, int16_t *dst, int frames)
+        {
+            const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f);
+            const __m256 half = _mm256_set1_ps(0.5f), scale = _mm256_set1_ps(OUT_SCALE);
+            int i = 0;
+            for (; i + 8 <= frames; i += 8)
+            {
+                __m256 l = _mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(src_l + i)));
+                __m256 r = _mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(src_r + i)));
+                __m256i m = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(l, r), half), scale));
+                __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+            }
+            FloatToShortDownmixScalar(src_l + i, src_r + i, dst + i, frames - i);
+        }
+        TARGET_AVX2 bool IsSilentAvx2(const int16_t *src, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 64 <= samples; i += 64)
+            {
+                const __m256i *p = reinterpret_cast<const __m256i *>(src + i);
+                __m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)),
+                                            _mm256_or_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+                if (!_mm256_testz_si256(v, v))
+                    return false;
+            }
+            return IsSilentSse2(src + i, samples - i);
+        }
+
+        bool CpuHasSse2()
+        {
+#ifdef _MSC_VER
+            int regs[4];
+            __cpuid(regs, 1);
+            return (regs[3] & (1 << 26)) != 0;
+#else
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+        bool CpuHasAvx2()
+        {
+#ifdef _MSC_VER
+            int regs[4];
+            __cpuid(regs, 0);
+            if (regs[0] < 7)
+                return false;
+            __cpuid(regs, 1);
+            bool osxsave = (regs[2] & (1 << 27)) != 0;
+            bool avx = (regs[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+                return false;
+            __cpuidex(regs, 7, 0);
+            return (regs[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        struct Kernels
+        {
+            Isa isa;
+            void (*short_to_float_mono)(const int16_t *, float *, int);
+            void (*short_to_float_stereo)(const int16_t *, float *, float *, int);
+            void (*float_to_short_mono)(const float *, int16_t *, int);
+            void (*float_to_short_stereo)(const float *, const float *, int16_t *, int);
+            void (*float_to_short_downmix)(const float *, const float *, int16_t *, int);
+            bool (*is_silent)(const int16_t *, size_t);
+        };
+        constexpr Kernels SCALAR_KERNELS = {Isa::scalar, ShortToFloatMonoScalar, ShortToFloatStereoScalar, FloatToShortMonoScalar, FloatToShortStereoScalar, FloatToShortDownmixScalar, IsSilentScalar};
+#if AUDIO_CONVERT_X86
+        constexpr Kernels SSE2_KERNELS = {Isa::sse2, ShortToFloatMonoSse2, ShortToFloatStereoSse2, FloatToShortMonoSse2, FloatToShortStereoSse2, FloatToShortDownmixSse2, IsSilentSse2};
+        constexpr Kernels AVX2_KERNELS = {Isa::avx2, ShortToFloatMonoAvx2, ShortToFloatStereoAvx2, FloatToShortMonoAvx2, FloatToShortStereoAvx2, FloatToShortDownmixAvx2, IsSilentAvx2};
+#endif
+        Isa BestIsa()
+        {
+#if AUDIO_CONVERT_X86
+            if (CpuHasAvx2())
+                return Isa::avx2;
+            if (CpuHasSse2())
+                return Isa::sse2;
+#endif
+            return Isa::scalar;
+        }
+        const Kernels *KernelsFor(Isa isa)
+        {
+#if AUDIO_CONVERT_X86
+            if (isa == Isa::avx2)
+                return &AVX2_KERNELS;
+            if (isa == Isa::sse2)
+                return &SSE2_KERNELS;
+#endif
+            return &SCALAR_KERNELS;
+        }
+        // 初回の呼び出しで判定する。同時に判定しても同じ値を書き込むだけなので排他はしない
+        std::atomic<const Kernels *> g_kernels = nullptr;
+        const Kernels &ActiveKernels()
+        {
+            const Kernels *kernels = g_kernels.load(std::memory_order_acquire);
+            if (!kernels)
+            {
+                kernels = KernelsFor(BestIsa());
+                g_kernels.store(kernels, std::memory_order_release);
+            }
+            return *kernels;
+        }
+    }
+
+    void ShortToFloatMono(const int16_t *src, float *dst, int frames) { ActiveKernels().short_to_float_mono(src, dst, frames); }
+    void ShortToFloatStereo(const int16_t *src, float *dst_l, float *dst_r, int frames) { ActiveKernels().short_to_float_stereo(src, dst_l, dst_r, frames); }
+    void FloatToShortMono(const float *src, int16_t *dst, int frames) { ActiveKernels().float_to_short_mono(src, dst, frames); }
+    void FloatToShortStereo(const float *src_l, const float *src_r, int16_t *dst, int frames) { ActiveKernels().float_to_short_stereo(src_l, src_r, dst, frames); }
+    void FloatToShortDownmix(const float *src_l, const float *src_r, int16_t *dst, int frames) { ActiveKernels().float_to_short_downmix(src_l, src_r, dst, frames); }
+    void ShortToFloatPlanar(const int16_t *src, int channels, float *const *dst, int frames)
+    {
+        if (channels == 1)
+            return ShortToFloatMono(src, dst[0], frames);
+        if (channels == 2)
+            return ShortToFloatStereo(src, dst[0], dst[1], frames);
+        for (int i = 0; i < frames; ++i)
+            for (int ch = 0; ch < channels; ++ch)
+                dst[ch][i] = static_cast<float>(src[i * channels + ch]) * IN_SCALE;
+    }
+    void FloatToShortInterleaved(const float *const *src, int channels, int16_t *dst, int frames)
+    {
+        if (channels == 1)
+            return FloatToShortMono(src[0], dst, frames);
+        if (channels == 2)
+            return FloatToShortStereo(src[0], src[1], dst, frames);
+        for (int i = 0; i < frames; ++i)
+            for (int ch = 0; ch < channels; ++ch)
+                dst[i * channels + ch] = ToShort(src[ch][i]);
+    }
+    bool IsSilent(const int16_t *src, size_t samples) { return ActiveKernels().is_silent(src, samples); }
+    Isa ActiveIsa() { return ActiveKernels().isa; }
+    bool SelectIsa(Isa isa)
+    {
+        if (static_cast<int>(isa) > static_cast<int>(BestIsa()))
+            return false;
+        g_kernels.store(KernelsFor(isa), std::memory_order_release);
+        return true;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// =================================================================
+// int16 <-> float 変換カーネル
+// =================================================================
+// 実装は起動時に CPU を判定して AVX2 / SSE2 / スカラーから選択されます。
+// いずれの実装もスカラー版とビット単位で同じ結果を返します。
+namespace audio_convert
+{
+    // int16 -> float: x / 32768.0f
+    void ShortToFloatMono(const int16_t *src, float *dst, int frames);
+    void ShortToFloatStereo(const int16_t *src, float *dst_l, float *dst_r, int frames);
+
+    // float -> int16: clamp(x, -1, 1) * 32767.0f (0 方向への切り捨て)
+    void FloatToShortMono(const float *src, int16_t *dst, int frames);
+    void FloatToShortStereo(const float *src_l, const float *src_r, int16_t *dst, int frames);
+    // (clamp(l) + clamp(r)) * 0.5f * 32767.0f
+    void FloatToShortDownmix(const float *src_l, const float *src_r, int16_t *dst, int frames);
+
+    // 任意チャンネル数のインターリーブ <-> プレーナ変換。1ch / 2ch は上記の専用カーネルを使います。
+    void ShortToFloatPlanar(const int16_t *src, int channels, float *const *dst, int frames);
+    void FloatToShortInterleaved(const float *const *src, int channels, int16_t *dst, int frames);
+
+    // samples 個 (インターリーブのままのサンプル数) がすべて 0 か。0 でない値が見つかった時点で戻ります
+    bool IsSilent(const int16_t *src, size_t samples);
+
+    enum class Isa : int
+    {
+        scalar,
+        sse2,
+        avx2,
+    };
+    Isa ActiveIsa();
+    // テストとベンチマーク用に、以降の呼び出しで使う実装を切り替えます。CPU が対応していなければ false
+    bool SelectIsa(Isa isa);
+}
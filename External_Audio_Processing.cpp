@@ -10,11 +10,30 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
 #include <commdlg.h>
+#include <Psapi.h>
 using byte = int8_t;
 #include <exedit.hpp>
+#include "Audio_Convert.h"
+#include "Audio_Cache.h"
+#include "Frame_Budget.h"
+#include "Host_Registry.h"
+#include "Ipc_Protocol.h"
+#include "Ipc_Transport.h"
+#include "State_Store.h"
+#include "Stats_Page.h"
+#include "Trace.h"
+#include "Shared_Layout.h"
+#include "Spin_Signal.h"
 
 #define WM_APP_UPDATE_GUI (WM_APP + 1)
+#define WM_APP_STATE_SYNCED (WM_APP + 2)
+#define WM_APP_LAUNCH_FAILED (WM_APP + 3)
 #ifdef _DEBUG
 #define DbgPrint(format, ...)                                                                                             \
     do                                                                                                                    \
@@ -35,7 +54,34 @@ const TCHAR *SHARED_MEM_NAME_BASE = _T("Local\\AviUtlAudioSharedAudio");
 const TCHAR *EVENT_CLIENT_READY_NAME_BASE = _T("Local\\AviUtlAudioClientReady");
 const TCHAR *EVENT_HOST_DONE_NAME_BASE = _T("Local\\AviUtlAudioHostDone");
 const int MAX_BLOCK_SIZE = 2048;
+const uint32_t RING_SLOT_COUNT = 4;
+const DWORD BLOCK_TIMEOUT_MS = 500;
+const DWORD PIPE_CONNECT_TIMEOUT_MS = 5000;
+const DWORD DEFAULT_EXPORT_TIMEOUT_MS = 60000;
+const uint32_t RING_SPIN_US = 100;
+const size_t SHARED_ARENA_SIZE = 32 * 1024 * 1024;
+const int MAX_PREWARM_PER_HOST = 8;
+const int DEFAULT_AUDIO_CACHE_MB = 64;
+const int MAX_REPORTED_LATENCY = 1 << 20;
+const int MAX_REPORTED_TAIL = 1 << 24;
+const int DEFAULT_PREROLL_MS = 500;
+const int MAX_PREROLL_MS = 10000;
+const int DEFAULT_FRAME_BUDGET_PERCENT = 100;
+const int DEFAULT_STATE_STORE_RETENTION_DAYS = 180;
+const int MAX_FRAME_BUDGET_PERCENT = 1000;
+const uint32_t MIN_FRAME_BUDGET_MS = 10;
+const size_t MAX_INPUT_HISTORY_BLOCKS = 64;
 const int STATE_B64_MAX_LEN = 65536;
+const char STATE_STORE_PREFIX[] = "store:";
+const DWORD STATE_SYNC_INTERVAL_MS = 250;
+const DWORD HOST_EVICT_INTERVAL_MS = 1000;
+const DWORD MIN_HOST_IDLE_MS = 10000;
+const DWORD RESTORE_WAIT_MS = 1000;
+const int AUTOMATION_LANE_COUNT = 4;
+const int AUTOMATION_RAMP_STEPS = 16;
+const int AUTOMATION_TRACK_MAX = 1000;
+const uint32_t AUTOMATION_EVENT_CAPACITY = AUTOMATION_LANE_COUNT * AUTOMATION_RAMP_STEPS;
+const int MAX_CHAIN_PLUGINS = 8;
 const int MAX_RESTART_ATTEMPTS = 3;
 const int CRASH_LOOP_THRESHOLD_MS = 60000;
 
@@ -43,58 +89,117 @@ const int CRASH_LOOP_THRESHOLD_MS = 60000;
 // 構造体・クラス定義
 // =================================================================
 #pragma pack(push, 1)
-struct AudioSharedData
-{
-    double sampleRate;
-    int32_t numSamples;
-    int32_t numChannels;
-};
 struct Exdata
 {
     TCHAR plugin_path[MAX_PATH];
     char state_b64[STATE_B64_MAX_LEN];
 };
+// plugin_path の後に同じホストの中で直列に処理するプラグイン (host_caps::chain)。
+// プロジェクトや元に戻すで扱う Exdata の大きさを変えないよう、state_b64 の末尾の領域に置く。
+// magic が一致しなければチェーンなしとみなす ('#' は base64 に現れないので古い状態と取り違えない)
+struct ChainRecord
+{
+    char magic[8];
+    TCHAR paths[MAX_CHAIN_PLUGINS - 1][MAX_PATH]; // 空の要素で終わる
+};
 #pragma pack(pop)
+static_assert(sizeof(Exdata) == MAX_PATH * sizeof(TCHAR) + STATE_B64_MAX_LEN, "Exdata layout is saved in projects");
+const char CHAIN_RECORD_MAGIC[8] = "#chain1";
+// state_b64 に書き込める状態の長さの上限 (終端を含む)。これより長い状態は保存領域に置く
+const size_t STATE_INLINE_MAX_LEN = STATE_B64_MAX_LEN - sizeof(ChainRecord);
 const int SHARED_MEM_TOTAL_SIZE = sizeof(AudioSharedData) + (4 * MAX_BLOCK_SIZE * sizeof(float));
 
+const ChainRecord *FindChainRecord(const Exdata *exdata)
+{
+    auto *record = reinterpret_cast<const ChainRecord *>(exdata->state_b64 + STATE_INLINE_MAX_LEN);
+    return memcmp(record->magic, CHAIN_RECORD_MAGIC, sizeof(CHAIN_RECORD_MAGIC)) == 0 ? record : nullptr;
+}
+
+// plugin_path の後に続くプラグインの数
+int ChainLength(const Exdata *exdata)
+{
+    const ChainRecord *record = FindChainRecord(exdata);
+    int length = 0;
+    while (record && length < MAX_CHAIN_PLUGINS - 1 && record->paths[length][0] != _T('\0'))
+        ++length;
+    return length;
+}
+
+const TCHAR *ChainPath(const Exdata *exdata, int index)
+{
+    return FindChainRecord(exdata)->paths[index];
+}
+
+// 状態は末尾の領域まで使っていることがあるので、呼び出し側で state_b64 を空にしてから呼ぶ
+void SetChainPath(Exdata *exdata, int index, const TCHAR *path)
+{
+    auto *record = reinterpret_cast<ChainRecord *>(exdata->state_b64 + STATE_INLINE_MAX_LEN);
+    if (!FindChainRecord(exdata))
+    {
+        memset(record, 0, sizeof(ChainRecord));
+        memcpy(record->magic, CHAIN_RECORD_MAGIC, sizeof(CHAIN_RECORD_MAGIC));
+    }
+    _tcscpy_s(record->paths[index], MAX_PATH, path);
+}
+
+void ClearChain(Exdata *exdata)
+{
+    memset(exdata->state_b64 + STATE_INLINE_MAX_LEN, 0, sizeof(ChainRecord));
+}
+
+// チェーン全体のパスを '|' (パスに使えない文字) でつないだもの。変更の検出とキャッシュのキーに使う
+std::basic_string<TCHAR> ChainKey(const Exdata *exdata)
+{
+    std::basic_string<TCHAR> key = exdata->plugin_path;
+    for (int i = 0; i < ChainLength(exdata); ++i)
+        key.append(_T("|")).append(ChainPath(exdata, i));
+    return key;
+}
+
+class HostProcess;
 class HostState;
+bool ExchangeCommand(HostProcess &process, int32_t instance_id, const char *command, char *response, DWORD responseSize);
+bool SendCommandToProcess(HostProcess &process, const char *command, char *response, DWORD responseSize);
 bool SendCommandToHost(HostState &state, const char *command, char *response, DWORD responseSize);
+bool SendStateCommandToHost(HostState &state, const char *command, const std::string &state_b64, char *response, DWORD responseSize);
+bool RequestStateFromHost(HostState &state, std::string &state_b64);
+bool RequestStateFromProcess(HostProcess &process, int32_t instance_id, std::string &state_b64);
 bool IsHostAlive(HostState &state);
+void ToUtf8(const TCHAR *src, char *dst, int dst_size);
 
-class HostState
+// ホストプロセス1つ分の資源。マルチインスタンス対応ホストでは複数の HostState から共有される
+class HostProcess
 {
 public:
-    TCHAR loaded_plugin_path[MAX_PATH] = {0};
+    TCHAR host_path[MAX_PATH] = {0};
     uint64_t unique_id = 0;
-    std::atomic<bool> host_running = false;
-    std::atomic<bool> gui_visible = false;
-    std::atomic<bool> crashed_notified = false;
-    std::atomic<bool> temporarily_disabled = false;
-    std::atomic<int> restart_attempts = 0;
-    std::atomic<ULONGLONG> last_crash_time = 0;
+    bool shared = false;
     PROCESS_INFORMATION pi = {};
-    HANDLE hPipe = INVALID_HANDLE_VALUE;
-    HANDLE hShm = NULL;
-    void *pSharedMem = nullptr;
-    HANDLE hEventClientReady = NULL;
-    HANDLE hEventHostDone = NULL;
+    ipc_transport::Channel pipe;
+    std::mutex pipe_mutex;
+    ipc_transport::SharedMemory shared_mem;
+    ipc_transport::Signal client_ready;
+    ipc_transport::Signal host_done;
+    uint32_t host_caps = 0;
+    uint32_t host_max_block_size = 0;
+    bool binary_protocol = false;
+    ipc_transport::SharedMemory arena;
+    char arena_name[MAX_PATH] = {0};
 
-    HostState()
+    HostProcess()
     {
         uint64_t tick = GetTickCount64();
         uint32_t pid = GetCurrentProcessId();
         static std::atomic<uint32_t> counter = 0;
         unique_id = (tick << 32) | (static_cast<uint64_t>(pid & 0xFFFF)) << 16 | (counter++ & 0xFFFF);
     }
-    ~HostState()
+    ~HostProcess()
     {
-        if (!host_running)
-            return;
-        DbgPrint(_T("~HostState: Cleaning up for unique_id %llu, ProcessID %lu"), unique_id, pi.dwProcessId);
-        if (IsHostAlive(*this))
+        DbgPrint(_T("~HostProcess: Cleaning up for unique_id %llu, ProcessID %lu"), unique_id, pi.dwProcessId);
+        if (IsAlive())
         {
             char response[64] = {};
-            SendCommandToHost(*this, "exit\n", response, sizeof(response));
+            SendCommandToProcess(*this, "exit\n", response, sizeof(response));
         }
         if (pi.hProcess)
         {
@@ -109,58 +214,411 @@ public:
                 DbgPrint(_T("Host process %lu exited gracefully."), pi.dwProcessId);
             }
         }
-        CleanupResources();
+        if (pi.hProcess)
+            CloseHandle(pi.hProcess);
+        if (pi.hThread)
+            CloseHandle(pi.hThread);
+    }
+
+    bool IsAlive()
+    {
+        if (pi.hProcess == NULL)
+            return false;
+        DWORD exitCode;
+        if (GetExitCodeProcess(pi.hProcess, &exitCode))
+            return exitCode == STILL_ACTIVE;
+        return false;
+    }
+
+    // アリーナ内の領域を first-fit で割り当てる。失敗時は SIZE_MAX
+    size_t AllocateRegion(size_t size)
+    {
+        size = (size + 63) & ~static_cast<size_t>(63);
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        for (auto it = arena_free.begin(); it != arena_free.end(); ++it)
+        {
+            if (it->second < size)
+                continue;
+            size_t offset = it->first;
+            size_t remaining = it->second - size;
+            arena_free.erase(it);
+            if (remaining > 0)
+                arena_free[offset + size] = remaining;
+            return offset;
+        }
+        return SIZE_MAX;
+    }
+    void FreeRegion(size_t offset, size_t size)
+    {
+        size = (size + 63) & ~static_cast<size_t>(63);
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        auto next = arena_free.lower_bound(offset);
+        if (next != arena_free.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = arena_free.erase(next);
+        }
+        if (next != arena_free.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset)
+            {
+                prev->second += size;
+                return;
+            }
+        }
+        arena_free[offset] = size;
+    }
+    void ResetArena(size_t size)
+    {
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        arena_free.clear();
+        arena_free[0] = size;
+    }
+
+private:
+    std::mutex arena_mutex;
+    std::map<size_t, size_t> arena_free;
+};
+
+// ホストの起動はバックグラウンドのランチャースレッドで行う。ready になるまで func_proc は音声を素通しする
+enum class LaunchStatus
+{
+    idle,
+    launching,
+    ready,
+    failed,
+};
+
+// 各 HostState の統計の公開先。HostState より先に破棄されないようここで定義する
+stats_page::Publisher g_stats_page;
+
+// エディタ上のオブジェクト1つ分の状態。instance_id >= 0 の場合は共有ホストプロセス内のインスタンスを指す
+class HostState
+{
+public:
+    std::basic_string<TCHAR> loaded_chain; // ChainKey
+    std::atomic<bool> host_running = false;
+    std::atomic<bool> gui_visible = false;
+    std::atomic<bool> crashed_notified = false;
+    std::atomic<bool> temporarily_disabled = false;
+    std::atomic<LaunchStatus> launch_status = LaunchStatus::idle;
+    // 退避 (HostEvictor) の判断に使う最後の func_proc の時刻。evicted は退避後まだ起動し直していないことを表す
+    std::atomic<uint64_t> last_used_us = 0;
+    std::atomic<bool> evicted = false;
+    // ready 以降の IPC と以下のメンバへのアクセスを保護する。launch_status / フラグ類は atomic なので不要
+    std::mutex mutex;
+    std::atomic<int> restart_attempts = 0;
+    std::atomic<ULONGLONG> last_crash_time = 0;
+    std::shared_ptr<HostProcess> process;
+    int32_t instance_id = -1;
+    // 専用ホストでは HostProcess のイベントを、共有ホストではインスタンス専用のイベントを指す
+    ipc_transport::Signal *client_ready = nullptr;
+    ipc_transport::Signal *host_done = nullptr;
+    ipc_transport::Signal instance_ready;
+    ipc_transport::Signal instance_done;
+    int block_size = MAX_BLOCK_SIZE;
+    int channel_count = 2;
+    int plugin_inputs = 0;
+    int plugin_outputs = 0;
+    std::atomic<int> latency_samples = 0;
+    std::atomic<int> sample_rate = 0;
+    // 直近のフレームのサンプル数。遅延をフレーム数に直して表示するために使う
+    std::atomic<int> frame_samples = 0;
+    bool offline_mode = false;
+    ipc_transport::SharedMemory ring_shm;
+    void *pRing = nullptr;
+    size_t arena_offset = SIZE_MAX;
+    size_t arena_size = 0;
+    uint32_t ring_seq = 0;
+    // 結果を受け取った (または待ち終えた) 最後の seq。ring_seq と異なればホストが処理中のスロットが残っている
+    uint32_t ring_collected = 0;
+    // シーク検出とプリロール。入力履歴はホストの再起動後も保持する
+    struct InputBlock
+    {
+        int frame = -1;
+        int channels = 0;
+        std::vector<short> samples;
+    };
+    // 最後に出力したブロックの位置。ホストを通したかどうかに関わらず、出力を返すたびに進める
+    bool has_position = false;
+    int last_frame = 0;
+    int last_milliframe = 0;
+    std::vector<InputBlock> input_history;
+    size_t history_next = 0;
+    std::vector<short> preroll_scratch;
+    std::atomic<uint64_t> preroll_samples = 0;
+    // プリロール中の待ち時間の締め切り。0 ならプリロール中ではない
+    uint64_t preroll_deadline_us = 0;
+    // ブロックの往復時間の履歴。待ち時間と、フレームの予算に収まるかの見積もりに使う
+    frame_budget::RoundTripEstimator round_trip;
+    // 無音のスキップ (host_caps::tail)。tail_samples が負なら余韻が終わらないものとしてスキップしない。
+    // silent_run は直近の音のある入力の後にホストへ続けて渡した (またはスキップした) 無音のサンプル数
+    // tail_stale の間はスキップせず、状態の同期のスレッドが問い合わせ直す。
+    // tail_epoch は古くなるたびに進め、問い合わせ中にさらに古くなった結果を捨てるのに使う
+    int tail_samples = -1;
+    bool tail_stale = false;
+    uint32_t tail_epoch = 0;
+    int64_t silent_run = 0;
+    // 起動に失敗した理由。ランチャースレッドが書き込み、WM_APP_LAUNCH_FAILED を受けたメインスレッドが表示して空にする
+    std::basic_string<TCHAR> launch_error_title;
+    std::basic_string<TCHAR> launch_error;
+    // host_caps::state_serial によるバックグラウンド同期。exdata への書き込みはメインスレッドで行う
+    HWND notify_hwnd = NULL;
+    uint32_t synced_state_serial = 0;
+    bool has_pending_state = false;
+    std::string pending_state; // Exdata::state_b64 にそのまま書き込める形式
+    std::string pinned_hash;   // このオブジェクトが最後に Pin した保存領域のキー
+    // トラックバーのオートメーション。値は最後にホストへ送ったもので、-1 は未送信
+    int automation_values[AUTOMATION_LANE_COUNT] = {-1, -1, -1, -1};
+    std::vector<AutomationEvent> automation_events; // サンプル位置はフレームの先頭から
+    size_t automation_cursor = 0;
+    stats_page::ObjectStats *stats = nullptr;
+
+    // 切り離したホストプロセスとインスタンス。ReleaseDetachedHost で破棄するまで共有プロセスの領域は解放しない
+    struct DetachedHost
+    {
+        std::shared_ptr<HostProcess> process;
+        int32_t instance_id = -1;
+        size_t arena_offset = SIZE_MAX;
+        size_t arena_size = 0;
+    };
+
+    ~HostState()
+    {
+        g_stats_page.Release(stats);
+        if (!host_running)
+            return;
+        ReleaseDetachedHost(DetachHost());
     }
 
     void CleanupForRestart()
     {
-        DbgPrint(_T("Cleaning up resources for restart (unique_id %llu)"), unique_id);
-        CleanupResources();
+        ReleaseDetachedHost(DetachForRestart());
+    }
+
+    // CleanupForRestart の前半。ホストとの通信とプロセスの終了待ちを含まないので、
+    // state.mutex を保持して呼び、戻り値はロックを離してから ReleaseDetachedHost に渡す
+    [[nodiscard]] DetachedHost DetachForRestart()
+    {
+        DbgPrint(_T("Cleaning up resources for restart (instance %d)"), instance_id);
+        DetachedHost detached = DetachHost();
         host_running = false;
         gui_visible = false;
+        launch_status = LaunchStatus::idle;
+        return detached;
+    }
+
+    // 共有プロセスのインスタンスを破棄する。最後の参照であれば ~HostProcess がプロセスの終了を待つ
+    static void ReleaseDetachedHost(DetachedHost detached)
+    {
+        if (detached.process && detached.instance_id >= 0)
+        {
+            if (detached.process->IsAlive())
+            {
+                char command[64];
+                char response[64];
+                sprintf_s(command, "destroy_instance %d\n", detached.instance_id);
+                SendCommandToProcess(*detached.process, command, response, sizeof(response));
+            }
+            if (detached.arena_offset != SIZE_MAX)
+                detached.process->FreeRegion(detached.arena_offset, detached.arena_size);
+        }
     }
 
 private:
-    void CleanupResources()
+    DetachedHost DetachHost()
     {
-        if (pi.hProcess)
-            CloseHandle(pi.hProcess);
-        if (pi.hThread)
-            CloseHandle(pi.hThread);
-        if (hPipe != INVALID_HANDLE_VALUE)
-            CloseHandle(hPipe);
-        if (pSharedMem)
-            UnmapViewOfFile(pSharedMem);
-        if (hShm)
-            CloseHandle(hShm);
-        if (hEventClientReady)
-            CloseHandle(hEventClientReady);
-        if (hEventHostDone)
-            CloseHandle(hEventHostDone);
-
-        pi = {};
-        hPipe = INVALID_HANDLE_VALUE;
-        pSharedMem = nullptr;
-        hShm = NULL;
-        hEventClientReady = NULL;
-        hEventHostDone = NULL;
+        DetachedHost detached{std::move(process), instance_id, arena_offset, arena_size};
+        ring_shm.Close();
+        instance_ready.Close();
+        instance_done.Close();
+
+        process.reset();
+        instance_id = -1;
+        client_ready = nullptr;
+        host_done = nullptr;
+        block_size = MAX_BLOCK_SIZE;
+        channel_count = 2;
+        plugin_inputs = 0;
+        plugin_outputs = 0;
+        latency_samples = 0;
+        sample_rate = 0;
+        offline_mode = false;
+        pRing = nullptr;
+        arena_offset = SIZE_MAX;
+        arena_size = 0;
+        ring_seq = 0;
+        ring_collected = 0;
+        has_position = false;
+        round_trip.Reset();
+        tail_samples = -1;
+        tail_stale = false;
+        silent_run = 0;
+        synced_state_serial = 0;
+        std::fill(std::begin(automation_values), std::end(automation_values), -1);
+        automation_events.clear();
+        return detached;
     }
 };
-std::mutex g_states_mutex;
-std::unordered_map<uint32_t, std::unique_ptr<HostState>> g_host_states;
+// ランチャースレッドへ渡す起動要求。func_proc の引数は呼び出し後に無効になるため必要な値を複製する
+struct LaunchRequest
+{
+    std::shared_ptr<HostState> state;
+    uint32_t object_id;
+    HWND hwnd;
+    TCHAR plugin_path[MAX_PATH];
+    std::vector<std::basic_string<TCHAR>> chain_paths;
+    std::string state_b64;
+    int audio_rate;
+    int audio_n;
+    int audio_ch;
+    ULONGLONG requested_at;
+};
+// 登録簿のロックは検索・追加・削除の間だけ保持する。IPC は各 HostState::mutex の下で行う
+host_registry::Registry<HostState> g_host_states;
+audio_cache::BlockCache g_audio_cache;
+std::atomic<int> g_preroll_ms = DEFAULT_PREROLL_MS;
+// 空でなければトレースを有効にし、終了時にこのファイルへ書き出す
+TCHAR g_trace_path[MAX_PATH] = {0};
 
-bool IsHostAlive(HostState &state)
+// 書き出し中はホストをオフライン処理に切り替え、リアルタイム用のタイムアウトの代わりに g_export_timeout_ms まで待つ
+// dry_frames / fallback_frames はオブジェクトごとに数える (同じフレームの2つのオブジェクトで 2)
+struct ExportStats
 {
-    if (!state.host_running || state.pi.hProcess == NULL)
+    std::atomic<uint32_t> frames = 0;          // 書き出したフレーム数。同じフレームの2つ目以降のオブジェクトは数えない
+    std::atomic<int> last_frame = -1;          // frames を数えた直近のフレーム番号
+    std::atomic<uint32_t> object_frames = 0;   // オブジェクトごとに処理したフレーム数の合計
+    std::atomic<uint32_t> dry_frames = 0;      // ホストが使えず未処理のまま出力したフレーム
+    std::atomic<uint32_t> fallback_frames = 0; // 途中でタイムアウト・ホスト終了したフレーム
+
+    void Reset()
     {
-        return false;
+        frames = 0;
+        last_frame = -1;
+        object_frames = 0;
+        dry_frames = 0;
+        fallback_frames = 0;
     }
-    DWORD exitCode;
-    if (GetExitCodeProcess(state.pi.hProcess, &exitCode))
+    // func_proc はフレームごとにオブジェクトの数だけ呼ばれるため、フレーム番号が変わったときだけ frames を進める
+    void CountFrame(int frame)
     {
-        return exitCode == STILL_ACTIVE;
+        object_frames++;
+        if (last_frame.exchange(frame) != frame)
+            frames++;
     }
-    return false;
+};
+std::atomic<bool> g_exporting = false;
+std::atomic<DWORD> g_export_timeout_ms = DEFAULT_EXPORT_TIMEOUT_MS;
+ExportStats g_export_stats;
+
+// 同じフレームのオブジェクト全体で共有する締め切り。プレビュー中はフレームの長さの
+// g_frame_budget_percent %、書き出し中は g_export_frame_budget_ms (0 なら無制限)
+frame_budget::Scheduler g_frame_budget;
+std::atomic<int> g_frame_budget_percent = DEFAULT_FRAME_BUDGET_PERCENT;
+std::atomic<DWORD> g_export_frame_budget_ms = 0;
+
+// 稼働中のホストの数とホストプロセスのメモリの上限。0 なら無制限
+std::atomic<int> g_max_live_hosts = 0;
+std::atomic<uint64_t> g_host_memory_budget = 0;
+
+// 保存領域のファイルを最後に使ってから消すまでの日数。0 なら消さない
+std::atomic<int> g_state_store_retention_days = DEFAULT_STATE_STORE_RETENTION_DAYS;
+
+// 1ブロックの待ち時間。プレビュー中はこのホストの往復時間から決め、どちらの場合もフレームの残り予算で打ち切る。
+// プリロール中はフレームの予算の代わりにプリロール用の締め切りで打ち切る
+DWORD BlockTimeoutMs(const HostState &state)
+{
+    const DWORD timeout_ms = g_exporting ? g_export_timeout_ms.load() : state.round_trip.TimeoutMs(BLOCK_TIMEOUT_MS);
+    const uint64_t now_us = stats_page::NowUs();
+    if (state.preroll_deadline_us != 0)
+        return static_cast<DWORD>(std::min<uint64_t>(timeout_ms, state.preroll_deadline_us > now_us ? (state.preroll_deadline_us - now_us + 999) / 1000 : 0));
+    return std::min<DWORD>(timeout_ms, g_frame_budget.RemainingMs(now_us));
+}
+
+void StartFrameBudget(ExEdit::FilterProcInfo *efpip, bool exporting)
+{
+    const uint32_t frame_ms = static_cast<uint32_t>(static_cast<int64_t>(efpip->audio_n) * 1000 / std::max(efpip->audio_rate, 1));
+    uint32_t budget_ms = exporting ? g_export_frame_budget_ms.load() : 0;
+    if (!exporting && g_frame_budget_percent > 0)
+        budget_ms = std::max(frame_ms * g_frame_budget_percent / 100, MIN_FRAME_BUDGET_MS);
+    g_frame_budget.Enter(efpip->frame, stats_page::NowUs(), frame_ms, budget_ms);
+}
+
+// 往復時間の履歴から、残りの予算では処理しきれないと見込まれるか
+bool ExceedsFrameBudget(const HostState &state, int samples)
+{
+    if (g_frame_budget.Unlimited() || !state.round_trip.HasSamples())
+        return false;
+    const int blocks = (samples + state.block_size - 1) / state.block_size;
+    return state.round_trip.PredictUs(blocks) > g_frame_budget.RemainingUs(stats_page::NowUs());
+}
+std::mutex g_processes_mutex;
+std::unordered_map<std::basic_string<TCHAR>, std::weak_ptr<HostProcess>> g_shared_processes;
+
+std::shared_ptr<HostState> FindHostState(uint32_t object_id)
+{
+    return g_host_states.Find(object_id);
+}
+
+// 破棄時にホストとの通信が発生するため、最後の参照は登録簿のロックの外で手放す
+void RemoveHostState(uint32_t object_id)
+{
+    if (std::shared_ptr<HostState> removed = g_host_states.Remove(object_id))
+        g_audio_cache.EraseObject(object_id);
+}
+
+// プラグイン (チェーン) が変更されていれば古い状態を破棄して作り直す
+std::shared_ptr<HostState> AcquireHostState(uint32_t object_id, const Exdata *exdata)
+{
+    std::shared_ptr<HostState> removed;
+    std::basic_string<TCHAR> chain = ChainKey(exdata);
+    auto matches = [&](const HostState &state)
+    {
+        if (state.loaded_chain == chain)
+            return true;
+        DbgPrint(_T("Plugin path mismatch for object %u. Old: '%s', New: '%s'. Re-launching host."),
+                 object_id, state.loaded_chain.c_str(), chain.c_str());
+        return false;
+    };
+    auto create = [&]
+    {
+        auto state = std::make_shared<HostState>();
+        state->loaded_chain = chain;
+        const TCHAR *filename = _tcsrchr(exdata->plugin_path, _T('\\'));
+        char name_mb[MAX_PATH];
+        ToUtf8(filename ? filename + 1 : exdata->plugin_path, name_mb, MAX_PATH);
+        if (int length = ChainLength(exdata); length > 0)
+        {
+            char suffix[16];
+            sprintf_s(suffix, " +%d", length);
+            strcat_s(name_mb, suffix);
+        }
+        state->stats = g_stats_page.Acquire(object_id, name_mb);
+        return state;
+    };
+    return g_host_states.Acquire(object_id, matches, create, removed);
+}
+
+bool IsHostReady(const HostState &state)
+{
+    return state.launch_status.load(std::memory_order_acquire) == LaunchStatus::ready;
+}
+
+// パラメーターが変わり、報告済みの余韻の長さが使えなくなった。state.mutex を保持して呼ぶ
+void MarkTailStale(HostState &state)
+{
+    state.tail_stale = true;
+    ++state.tail_epoch;
+}
+
+bool IsHostAlive(HostState &state)
+{
+    if (!state.host_running || !state.process)
+    {
+        return false;
+    }
+    return state.process->IsAlive();
 }
 
 // =================================================================
@@ -178,23 +636,56 @@ namespace idx_check
     {
         select_plugin,
         toggle_gui,
+        append_plugin,
+        count
+    };
+}
+const char *check_names[] = {"プラグインを選択", "プラグインGUIを表示", "プラグインを後ろに追加"};
+const int32_t check_default[] = {-1, -1, -1};
+// -1 はオートメーションしない。0〜AUTOMATION_TRACK_MAX をホストへ 0.0〜1.0 で渡す
+namespace idx_track
+{
+    enum id : int
+    {
+        lane1,
+        lane2,
+        lane3,
+        lane4,
         count
     };
 }
-const char *check_names[] = {"プラグインを選択", "プラグインGUIを表示"};
-const int32_t check_default[] = {-1, -1};
+static_assert(idx_track::count == AUTOMATION_LANE_COUNT);
+const char *track_names[] = {"パラメータ1", "パラメータ2", "パラメータ3", "パラメータ4"};
+const int32_t track_default[] = {-1, -1, -1, -1};
+const int32_t track_s[] = {-1, -1, -1, -1};
+const int32_t track_e[] = {AUTOMATION_TRACK_MAX, AUTOMATION_TRACK_MAX, AUTOMATION_TRACK_MAX, AUTOMATION_TRACK_MAX};
 const Exdata exdata_def = {_T(""), ""};
 BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip);
 BOOL func_init(ExEdit::Filter *efp);
 BOOL func_exit(ExEdit::Filter *efp);
 BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl::EditHandle *editp, ExEdit::Filter *efp);
 int32_t func_window_init(HINSTANCE hinstance, HWND hwnd, int y, int base_id, int sw_param, ExEdit::Filter *efp);
-bool LaunchHostProcess(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip, HostState &state);
+bool LaunchHostProcess(const LaunchRequest &request, HostState &state);
+void QueryPluginTail(HostState &state);
+void RequestHostLaunch(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip, const std::shared_ptr<HostState> &state);
+void StopHostLauncher();
+void StartStateSync();
+void StopStateSync();
+void StartHostEvictor();
+void StopHostEvictor();
+void StartHostPool();
+void StopHostPool();
+void LoadSettings();
 consteval ExEdit::Filter filter_template(ExEdit::Filter::Flag flag)
 {
     return {
         .flag = flag,
         .name = const_cast<char *>(filter_name),
+        .track_n = idx_track::count,
+        .track_name = const_cast<char **>(track_names),
+        .track_default = const_cast<int *>(track_default),
+        .track_s = const_cast<int *>(track_s),
+        .track_e = const_cast<int *>(track_e),
         .check_n = idx_check::count,
         .check_name = const_cast<char **>(check_names),
         .check_default = const_cast<int *>(check_default),
@@ -215,88 +706,673 @@ inline constinit auto effect = filter_template(ExEdit::Filter::Flag::Audio | ExE
 // =================================================================
 // フィルター関数実装
 // =================================================================
+// Exdata::state_b64 は従来の base64 そのものか、"store:<SHA-256>;<base64>" の形式。
+// 後者の base64 部分は保存領域にファイルがない場合の予備で、収まらない場合は空になる
+bool ResolveSavedState(const char *saved, std::string &state_b64)
+{
+    const size_t prefix_len = sizeof(STATE_STORE_PREFIX) - 1;
+    if (strncmp(saved, STATE_STORE_PREFIX, prefix_len) != 0)
+    {
+        state_b64 = saved;
+        return true;
+    }
+    std::string hash(saved + prefix_len, strnlen(saved + prefix_len, state_store::HASH_HEX_LENGTH));
+    const char *separator = strchr(saved + prefix_len, ';');
+    std::vector<uint8_t> raw;
+    if (state_store::Get(hash, raw))
+    {
+        ipc_protocol::Base64Encode(raw.data(), raw.size(), state_b64);
+        return true;
+    }
+    if (separator && separator[1] != '\0')
+    {
+        DbgPrint(_T("State %hs is not in the store. Using the inline copy."), hash.c_str());
+        state_b64 = separator + 1;
+        return true;
+    }
+    DbgPrint(_T("State %hs is not in the store and has no inline copy."), hash.c_str());
+    state_b64.clear();
+    return false;
+}
+
+// 保存領域への書き込みを含むため、バックグラウンド同期ではメインスレッドの外で呼ぶ
+bool FormatStateReference(const std::string &state_b64, size_t dst_size, std::string &reference)
+{
+    std::vector<uint8_t> raw;
+    std::string hash;
+    if (!state_b64.empty() && ipc_protocol::Base64Decode(state_b64, raw))
+        hash = state_store::Put(raw.data(), raw.size());
+    if (hash.empty())
+    {
+        if (state_b64.size() >= dst_size)
+            return false;
+        reference = state_b64;
+        return true;
+    }
+    reference = STATE_STORE_PREFIX + hash + ";";
+    if (reference.size() + state_b64.size() < dst_size)
+        reference += state_b64;
+    return true;
+}
+
+// 保存領域のキーと、exdata に状態の複製が含まれているかを取り出す。保存領域を使わない形式なら false
+bool ParseStateReference(const char *reference, std::string &hash, bool &has_inline)
+{
+    const size_t prefix_len = sizeof(STATE_STORE_PREFIX) - 1;
+    if (strncmp(reference, STATE_STORE_PREFIX, prefix_len) != 0)
+        return false;
+    const char *separator = strchr(reference + prefix_len, ';');
+    hash.assign(reference + prefix_len, separator ? separator : reference + strlen(reference));
+    has_inline = separator && separator[1] != '\0';
+    return true;
+}
+
+// exdata に書き込まれずに使われなくなった参照。保存領域に作ったばかりのファイルなら消える
+void DiscardStateReference(const std::string &reference)
+{
+    std::string hash;
+    bool has_inline = false;
+    if (ParseStateReference(reference.c_str(), hash, has_inline))
+        state_store::Discard(hash);
+}
+
+// GUI を閉じたときなど、ユーザーが確定させた exdata の参照に複製が含まれていなければ、保存領域のファイルを
+// 期限切れで消さないようにする。前に Pin したファイルは置き換えられたので期限に任せる。state.mutex を保持して呼ぶ
+void PinStoredState(HostState &state, const char *reference)
+{
+    std::string hash;
+    bool has_inline = false;
+    if (!ParseStateReference(reference, hash, has_inline) || has_inline)
+        hash.clear();
+    if (hash == state.pinned_hash)
+        return;
+    if (!state.pinned_hash.empty())
+        state_store::Unpin(state.pinned_hash);
+    if (!hash.empty())
+        state_store::Pin(hash);
+    state.pinned_hash = std::move(hash);
+}
+
+bool StoreStateInExdata(const std::string &state_b64, char *dst, size_t dst_size)
+{
+    std::string reference;
+    if (!FormatStateReference(state_b64, dst_size, reference))
+        return false;
+    memcpy(dst, reference.c_str(), reference.size() + 1);
+    return true;
+}
+
+// ホストが host_caps::state_serial に対応していれば現在の通し番号を返す。state.mutex を保持して呼ぶ
+bool ReadStateSerial(HostState &state, uint32_t &serial)
+{
+    if (!state.host_running || !state.pRing || !(state.process->host_caps & host_caps::state_serial))
+        return false;
+    serial = std::atomic_ref<uint32_t>(static_cast<RingHeader *>(state.pRing)->stateSerial).load(std::memory_order_acquire);
+    return true;
+}
+
+// exdata に書き込む前の状態を置き換える。古い方は二度と使われない。state.mutex を保持して呼ぶ
+void SetPendingState(HostState &state, std::string reference)
+{
+    if (state.has_pending_state)
+        DiscardStateReference(state.pending_state);
+    state.pending_state = std::move(reference);
+    state.has_pending_state = true;
+}
+
+void ClearPendingState(HostState &state)
+{
+    if (state.has_pending_state)
+        DiscardStateReference(state.pending_state);
+    state.has_pending_state = false;
+    state.pending_state.clear();
+}
+
+// バックグラウンドで取得済みの状態を exdata に書き込む。state.mutex を保持して呼ぶ。
+// func_proc からも毎フレーム呼ぶので、ここでは Pin しない
+bool ApplyPendingState(HostState &state, Exdata *exdata)
+{
+    if (!state.has_pending_state)
+        return false;
+    memcpy(exdata->state_b64, state.pending_state.c_str(), state.pending_state.size() + 1);
+    state.has_pending_state = false;
+    state.pending_state.clear();
+    return true;
+}
+
 BOOL SaveStateIfGuiVisible(ExEdit::Filter *efp)
 {
     uint32_t object_id = static_cast<uint32_t>(efp->processing);
     auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
-    std::lock_guard<std::mutex> lock(g_states_mutex);
-    auto it = g_host_states.find(object_id);
-    if (it == g_host_states.end() || !it->second->host_running || !it->second->gui_visible)
+    auto state_ptr = FindHostState(object_id);
+    if (!state_ptr || !IsHostReady(*state_ptr) || !state_ptr->gui_visible)
     {
         return FALSE;
     }
-    auto &state = *it->second;
+    auto &state = *state_ptr;
+    std::lock_guard<std::mutex> lock(state.mutex);
     if (!IsHostAlive(state))
     {
         DbgPrint(_T("SaveStateIfGuiVisible: Host is not alive. Cannot save state."));
         return FALSE;
     }
-    DbgPrint(_T("Saving state for object %u because GUI is open."), object_id);
-    std::vector<char> state_response(STATE_B64_MAX_LEN + 100);
-    if (SendCommandToHost(state, "get_state\n", state_response.data(), (DWORD)state_response.size()))
+    uint32_t serial = 0;
+    const bool has_serial = ReadStateSerial(state, serial);
+    if (has_serial && serial == state.synced_state_serial)
     {
-        if (strncmp(state_response.data(), "OK ", 3) == 0)
+        // 最新の状態はバックグラウンドで取得済み
+        if (state.has_pending_state)
         {
             efp->exfunc->set_undo(efp->processing, 0);
-            char *state_ptr = state_response.data() + 3;
-            size_t len = strlen(state_ptr);
-            if (len > 0 && state_ptr[len - 1] == '\n')
-            {
-                state_ptr[len - 1] = '\0';
-            }
-            strncpy_s(exdata->state_b64, sizeof(exdata->state_b64), state_ptr, _TRUNCATE);
-            DbgPrint(_T("State saved for object %u. Length: %zu"), object_id, strlen(exdata->state_b64));
-            return TRUE;
-        }
-        else
-        {
-            DbgPrint(_T("Failed to get state: %hs"), state_response.data());
+            ApplyPendingState(state, exdata);
         }
+        PinStoredState(state, exdata->state_b64);
+        DbgPrint(_T("State for object %u is already in sync (serial %u)."), object_id, serial);
+        return TRUE;
     }
-    else
+    DbgPrint(_T("Saving state for object %u because GUI is open."), object_id);
+    std::string state_b64;
+    if (!RequestStateFromHost(state, state_b64))
+    {
+        DbgPrint(_T("get_state failed for object %u."), object_id);
+        return FALSE;
+    }
+    efp->exfunc->set_undo(efp->processing, 0);
+    if (!StoreStateInExdata(state_b64, exdata->state_b64, STATE_INLINE_MAX_LEN))
     {
-        DbgPrint(_T("SendCommandToHost for get_state failed for object %u."), object_id);
+        DbgPrint(_T("State for object %u is too large to store inline (%zu bytes) and the state store is unavailable. Keeping the previous state."), object_id, state_b64.size());
+        return FALSE;
     }
-    return FALSE;
+    PinStoredState(state, exdata->state_b64);
+    if (has_serial)
+        state.synced_state_serial = serial;
+    ClearPendingState(state);
+    DbgPrint(_T("State saved for object %u. Length: %zu"), object_id, state_b64.size());
+    return TRUE;
 }
 
-BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip)
+enum class BlockResult
 {
-    auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
-    uint32_t object_id = static_cast<uint32_t>(efp->processing);
+    ok,
+    timed_out,
+    host_lost,
+};
 
-    if (_tcslen(exdata->plugin_path) == 0 || efpip->audio_n == 0)
+void ConvertBlockToFloat(const short *src, int channels, float *dst_l, float *dst_r, int frames)
+{
+    if (channels == 2)
     {
-        std::lock_guard<std::mutex> lock(g_states_mutex);
-        if (g_host_states.count(object_id))
-        {
-            DbgPrint(_T("Plugin path is empty, cleaning up leftover host for object %u."), object_id);
-            g_host_states.erase(object_id);
-        }
-        return TRUE;
+        audio_convert::ShortToFloatStereo(src, dst_l, dst_r, frames);
+    }
+    else
+    {
+        audio_convert::ShortToFloatMono(src, dst_l, frames);
+        memcpy(dst_r, dst_l, frames * sizeof(float));
     }
+}
+
+void ConvertBlockToShort(const float *src_l, const float *src_r, int channels, short *dst, int frames)
+{
+    if (channels == 2)
+        audio_convert::FloatToShortStereo(src_l, src_r, dst, frames);
+    else
+        audio_convert::FloatToShortDownmix(src_l, src_r, dst, frames);
+}
+
+// 聞こえるブロックの往復だけを統計と往復時間の見積もりに入れる
+void RecordBlock(HostState &state, uint64_t round_trip_us)
+{
+    if (state.preroll_deadline_us != 0)
+        return;
+    stats_page::RecordRoundTrip(*state.stats, round_trip_us);
+    state.round_trip.Add(round_trip_us);
+    stats_page::Add(state.stats->blocks, 1);
+}
+
+BlockResult ProcessBlocksLegacy(HostState &state, ExEdit::FilterProcInfo *efpip, const short *audio_in, short *audio_out, int &samples_done)
+{
+    const int channels = efpip->audio_ch;
+    const int total_samples = efpip->audio_n;
+    auto *shared_data = static_cast<AudioSharedData *>(state.process->shared_mem.Data());
+    auto *shared_buffer = reinterpret_cast<float *>(shared_data + 1);
+
+    const int block_size = std::min(MAX_BLOCK_SIZE, state.block_size);
 
-    std::lock_guard<std::mutex> lock(g_states_mutex);
-    auto it = g_host_states.find(object_id);
-    if (it != g_host_states.end())
+    auto &stats = *state.stats;
+    while (samples_done < total_samples)
     {
-        if (_tcscmp(it->second->loaded_plugin_path, exdata->plugin_path) != 0)
+        TRACE_SPAN("block", samples_done);
+        int samples_to_process = std::min(total_samples - samples_done, block_size);
+        uint64_t started = stats_page::NowUs();
+        ConvertBlockToFloat(audio_in + samples_done * channels, channels, shared_buffer, shared_buffer + MAX_BLOCK_SIZE, samples_to_process);
+        uint64_t submitted = stats_page::NowUs();
+        shared_data->sampleRate = efpip->audio_rate;
+        shared_data->numSamples = samples_to_process;
+        shared_data->numChannels = channels;
+        ipc_transport::WaitResult waitResult;
+        {
+            TRACE_SPAN("block_wait");
+            state.host_done->Reset();
+            state.client_ready->Set();
+            waitResult = state.host_done->Wait(BlockTimeoutMs(state));
+        }
+        if (waitResult != ipc_transport::WaitResult::signaled)
         {
-            DbgPrint(_T("Plugin path mismatch for object %u. Old: '%s', New: '%s'. Re-launching host."),
-                     object_id, it->second->loaded_plugin_path, exdata->plugin_path);
-            g_host_states.erase(it);
+            DbgPrint(_T("Wait for host failed (result: %d)."), static_cast<int>(waitResult));
+            return IsHostAlive(state) ? BlockResult::timed_out : BlockResult::host_lost;
         }
+        uint64_t done = stats_page::NowUs();
+        ConvertBlockToShort(shared_buffer + 2 * MAX_BLOCK_SIZE, shared_buffer + 3 * MAX_BLOCK_SIZE, channels, audio_out + samples_done * channels, samples_to_process);
+        samples_done += samples_to_process;
+        RecordBlock(state, done - submitted);
+        stats_page::Add(stats.convertUs, (submitted - started) + (stats_page::NowUs() - done));
+        stats_page::Add(stats.bytesToHost, 2 * static_cast<uint64_t>(samples_to_process) * sizeof(float));
+        stats_page::Add(stats.bytesFromHost, 2 * static_cast<uint64_t>(samples_to_process) * sizeof(float));
     }
-    if (g_host_states.find(object_id) == g_host_states.end())
+    return BlockResult::ok;
+}
+
+bool WaitForRingSlot(HostState &state, RingSlotHeader *slot, uint32_t seq, DWORD timeout_ms)
+{
+    TRACE_SPAN("ring_wait", seq);
+    auto *ring = static_cast<RingHeader *>(state.pRing);
+    if (ring->signalMode == ring_signal::spin)
     {
-        g_host_states[object_id] = std::make_unique<HostState>();
+        return spin_signal::WaitFor(slot->doneSeq, seq, ring->clientSleeping, RING_SPIN_US, timeout_ms, [&](uint32_t, uint32_t wait_ms)
+                                    {
+                                        state.host_done->Wait(wait_ms);
+                                        state.host_done->Reset();
+                                    });
     }
-    auto &state = *g_host_states[object_id];
-    if (state.temporarily_disabled)
+    ULONGLONG deadline = GetTickCount64() + timeout_ms;
+    for (;;)
     {
-        return TRUE;
+        state.host_done->Reset();
+        if (std::atomic_ref<uint32_t>(slot->doneSeq).load(std::memory_order_acquire) == seq)
+            return true;
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline)
+            return false;
+        if (state.host_done->Wait(static_cast<DWORD>(deadline - now)) == ipc_transport::WaitResult::failed)
+            return false;
     }
-    if (state.host_running && !IsHostAlive(state))
+}
+
+// フレーム内の [offset, offset + count) に入るイベントをブロック先頭からの位置に直してスロットへ書き込む
+uint32_t WriteSlotEvents(HostState &state, const RingHeader *ring, RingSlotHeader *slot, int offset, int count)
+{
+    if (ring->eventCapacity == 0)
+        return 0;
+    AutomationEvent *events = RingSlotEvents(ring, slot);
+    uint32_t written = 0;
+    for (; state.automation_cursor < state.automation_events.size(); ++state.automation_cursor)
+    {
+        const AutomationEvent &event = state.automation_events[state.automation_cursor];
+        if (event.sampleOffset >= static_cast<uint32_t>(offset + count))
+            break;
+        if (written == ring->eventCapacity)
+            continue;
+        events[written] = event;
+        events[written].sampleOffset -= std::min(event.sampleOffset, static_cast<uint32_t>(offset));
+        ++written;
+    }
+    return written;
+}
+
+// トラックバーの値が変わったレーンのイベントを作る。連続再生中は前のフレームの値から直線で補間する
+void BuildAutomationEvents(HostState &state, const ExEdit::Filter *efp, int frames, bool contiguous)
+{
+    state.automation_events.clear();
+    state.automation_cursor = 0;
+    for (int lane = 0; lane < AUTOMATION_LANE_COUNT; ++lane)
+    {
+        const int value = efp->track[lane];
+        const int previous = state.automation_values[lane];
+        if (value < 0 || value == previous)
+            continue;
+        state.automation_values[lane] = value;
+        if (!contiguous || previous < 0)
+        {
+            state.automation_events.push_back({0, static_cast<uint32_t>(lane), static_cast<float>(value) / AUTOMATION_TRACK_MAX});
+            continue;
+        }
+        for (int step = 1; step <= AUTOMATION_RAMP_STEPS; ++step)
+        {
+            uint32_t offset = static_cast<uint32_t>(frames * (step - 1) / AUTOMATION_RAMP_STEPS);
+            float ramp = previous + static_cast<float>(value - previous) * step / AUTOMATION_RAMP_STEPS;
+            state.automation_events.push_back({offset, static_cast<uint32_t>(lane), ramp / AUTOMATION_TRACK_MAX});
+        }
+    }
+    std::stable_sort(state.automation_events.begin(), state.automation_events.end(), [](const AutomationEvent &a, const AutomationEvent &b)
+                     { return a.sampleOffset < b.sampleOffset; });
+}
+
+// 前回タイムアウトしたときに投入したままのスロットを、ホストが処理し終えるまで待つ。
+// ホストは seq の順に処理するので、最後に投入した seq が完了していれば残りもすべて完了している
+bool DrainRing(HostState &state)
+{
+    if (state.ring_collected == state.ring_seq)
+        return true;
+    TRACE_SPAN("ring_drain", state.ring_seq);
+    RingSlotHeader *slot = RingSlot(state.pRing, state.ring_seq);
+    if (!WaitForRingSlot(state, slot, state.ring_seq, BlockTimeoutMs(state)))
+    {
+        DbgPrint(_T("Ring still busy with seq %u (collected %u)."), state.ring_seq, state.ring_collected);
+        return false;
+    }
+    state.ring_collected = state.ring_seq;
+    return true;
+}
+
+BlockResult ProcessBlocksRing(HostState &state, ExEdit::FilterProcInfo *efpip, const short *audio_in, short *audio_out, int &samples_done)
+{
+    auto *ring = static_cast<RingHeader *>(state.pRing);
+    const int block_size = static_cast<int>(ring->blockSize);
+    // submitted_at は RING_SLOT_COUNT 個分しかないので、ホストが報告した数がそれより大きくても使わない
+    const int slot_count = std::min(static_cast<int>(ring->slotCount), static_cast<int>(RING_SLOT_COUNT));
+    const int channels = efpip->audio_ch;
+    const int total_samples = efpip->audio_n;
+    const int block_count = (total_samples + block_size - 1) / block_size;
+    const uint32_t first_seq = state.ring_seq + 1;
+    if (channels > static_cast<int>(ring->channelCount))
+    {
+        DbgPrint(_T("Channel count %d exceeds ring layout (%u)."), channels, ring->channelCount);
+        return BlockResult::timed_out;
+    }
+    // ホストがまだ書き込んでいるスロットに次のブロックを書くと入出力が混ざる
+    if (!DrainRing(state))
+        return IsHostAlive(state) ? BlockResult::timed_out : BlockResult::host_lost;
+    float *planes[RING_MAX_CHANNELS];
+    auto &stats = *state.stats;
+    uint64_t submitted_at[RING_SLOT_COUNT];
+
+    // ホストがブロック k を処理している間にブロック k+1 以降を変換・投入する
+    int submitted = 0;
+    for (int completed = 0; completed < block_count; ++completed)
+    {
+        while (submitted < block_count && submitted - completed < slot_count)
+        {
+            uint32_t seq = first_seq + submitted;
+            TRACE_SPAN("ring_submit", seq);
+            RingSlotHeader *slot = RingSlot(state.pRing, seq);
+            int offset = submitted * block_size;
+            int count = std::min(total_samples - offset, block_size);
+            for (int ch = 0; ch < channels; ++ch)
+                planes[ch] = RingSlotInput(ring, slot, ch);
+            uint64_t started = stats_page::NowUs();
+            audio_convert::ShortToFloatPlanar(audio_in + offset * channels, channels, planes, count);
+            submitted_at[submitted % RING_SLOT_COUNT] = stats_page::NowUs();
+            stats_page::Add(stats.convertUs, submitted_at[submitted % RING_SLOT_COUNT] - started);
+            stats_page::Add(stats.bytesToHost, static_cast<uint64_t>(channels) * count * sizeof(float));
+            slot->sampleRate = efpip->audio_rate;
+            slot->numSamples = count;
+            slot->numChannels = channels;
+            slot->numEvents = WriteSlotEvents(state, ring, slot, offset, count);
+            state.ring_seq = seq;
+            if (ring->signalMode == ring_signal::spin)
+            {
+                spin_signal::Publish(slot->submitSeq, seq, ring->hostSleeping, [&]
+                                     { state.client_ready->Set(); });
+            }
+            else
+            {
+                std::atomic_ref<uint32_t>(slot->submitSeq).store(seq, std::memory_order_release);
+                state.client_ready->Set();
+            }
+            ++submitted;
+        }
+
+        uint32_t seq = first_seq + completed;
+        RingSlotHeader *slot = RingSlot(state.pRing, seq);
+        if (!WaitForRingSlot(state, slot, seq, BlockTimeoutMs(state)))
+        {
+            DbgPrint(_T("Wait for ring slot seq %u failed."), seq);
+            return IsHostAlive(state) ? BlockResult::timed_out : BlockResult::host_lost;
+        }
+        TRACE_SPAN("ring_collect", seq);
+        state.ring_collected = seq;
+        uint64_t done = stats_page::NowUs();
+        RecordBlock(state, done - submitted_at[completed % RING_SLOT_COUNT]);
+        int offset = completed * block_size;
+        int count = std::min(total_samples - offset, block_size);
+        for (int ch = 0; ch < channels; ++ch)
+            planes[ch] = RingSlotOutput(ring, slot, ch);
+        audio_convert::FloatToShortInterleaved(planes, channels, audio_out + offset * channels, count);
+        samples_done = offset + count;
+        stats_page::Add(stats.convertUs, stats_page::NowUs() - done);
+        stats_page::Add(stats.bytesFromHost, static_cast<uint64_t>(channels) * count * sizeof(float));
+    }
+    return BlockResult::ok;
+}
+
+// プリロールに使うため、処理したフレームの入力を直近 g_preroll_ms 分だけ保持する
+void RecordInputHistory(HostState &state, ExEdit::FilterProcInfo *efpip, const short *audio_in)
+{
+    const int window = g_preroll_ms * efpip->audio_rate / 1000;
+    const size_t blocks = std::clamp(static_cast<size_t>(window / efpip->audio_n) + 2, size_t(1), MAX_INPUT_HISTORY_BLOCKS);
+    if (state.input_history.size() != blocks)
+    {
+        state.input_history.resize(blocks);
+        state.history_next = 0;
+    }
+    auto &entry = state.input_history[state.history_next];
+    state.history_next = (state.history_next + 1) % blocks;
+    entry.frame = efpip->frame;
+    entry.channels = efpip->audio_ch;
+    entry.samples.assign(audio_in, audio_in + static_cast<size_t>(efpip->audio_n) * efpip->audio_ch);
+}
+
+// 直前に出力したブロックの続きか。フレーム番号に加えてオブジェクト内の再生位置 (audio_milliframe) が
+// 戻っていないことを確かめ、再生位置のトラックバーなどで音声の位置だけが巻き戻った場合もシークとみなす
+bool IsContiguous(const HostState &state, const ExEdit::FilterProcInfo *efpip)
+{
+    return state.has_position && efpip->frame == state.last_frame + 1 && efpip->audio_milliframe >= state.last_milliframe;
+}
+
+// ブロックを出力した位置を記録する。キャッシュ・素通し・無音のスキップでも呼び、次のフレームで不要なプリロールをしないようにする
+void AdvancePosition(HostState &state, ExEdit::FilterProcInfo *efpip, const short *audio_in)
+{
+    state.has_position = true;
+    state.last_frame = efpip->frame;
+    state.last_milliframe = efpip->audio_milliframe;
+    if (g_preroll_ms > 0)
+        RecordInputHistory(state, efpip, audio_in);
+}
+
+const HostState::InputBlock *FindInputHistory(const HostState &state, int frame, int channels)
+{
+    for (auto &entry : state.input_history)
+    {
+        if (entry.frame == frame && entry.channels == channels && !entry.samples.empty())
+            return &entry;
+    }
+    return nullptr;
+}
+
+// シーク後、直前のフレームの入力をホストに流して出力を捨てる。
+// 直前のフレームを処理した履歴がなければ無音を流し、シーク前の残響などを消す。
+// プリロールはフレームの予算と同じ長さの別枠で待ち、かかった時間はフレームの締め切りに含めない
+void RunPreroll(HostState &state, ExEdit::FilterProcInfo *efpip)
+{
+    TRACE_SPAN("preroll", efpip->frame);
+    const int channels = efpip->audio_ch;
+    const int window = g_preroll_ms * efpip->audio_rate / 1000;
+    const HostState::InputBlock *history[MAX_INPUT_HISTORY_BLOCKS];
+    size_t history_count = 0;
+    int covered = 0;
+    for (int frame = efpip->frame - 1; frame >= 0 && covered < window && history_count < MAX_INPUT_HISTORY_BLOCKS; --frame)
+    {
+        auto *entry = FindInputHistory(state, frame, channels);
+        if (!entry)
+            break;
+        history[history_count++] = entry;
+        covered += static_cast<int>(entry->samples.size()) / channels;
+    }
+    // 起動直後のホストには消すべき状態がない
+    if (history_count == 0 && !state.has_position)
+        return;
+
+    const uint64_t started_us = stats_page::NowUs();
+    state.preroll_deadline_us = g_frame_budget.Unlimited() ? UINT64_MAX : started_us + g_frame_budget.BudgetUs();
+    ExEdit::FilterProcInfo info = *efpip;
+    int fed = 0;
+    auto feed = [&](const short *input, int frames)
+    {
+        state.preroll_scratch.resize(static_cast<size_t>(frames) * channels);
+        info.audio_n = frames;
+        int samples_done = 0;
+        BlockResult result = state.pRing ? ProcessBlocksRing(state, &info, input, state.preroll_scratch.data(), samples_done)
+                                         : ProcessBlocksLegacy(state, &info, input, state.preroll_scratch.data(), samples_done);
+        fed += samples_done;
+        return result == BlockResult::ok;
+    };
+    if (history_count > 0)
+    {
+        for (size_t i = history_count; i-- > 0;)
+        {
+            if (!feed(history[i]->samples.data(), static_cast<int>(history[i]->samples.size()) / channels))
+                break;
+        }
+    }
+    else
+    {
+        std::vector<short> silence(static_cast<size_t>(efpip->audio_n) * channels, 0);
+        for (int remaining = window; remaining > 0; remaining -= efpip->audio_n)
+        {
+            if (!feed(silence.data(), std::min(remaining, efpip->audio_n)))
+                break;
+        }
+    }
+    state.preroll_deadline_us = 0;
+    g_frame_budget.Extend(stats_page::NowUs() - started_us);
+    state.preroll_samples += fed;
+    DbgPrint(_T("Preroll before frame %d: %d samples (%hs). Total: %llu"), efpip->frame, fed,
+             history_count > 0 ? "history" : "silence", state.preroll_samples.load());
+}
+
+// 書き出し中は素通しせず、起動が終わるまで待つ
+LaunchStatus WaitForLaunch(HostState &state, DWORD timeout_ms)
+{
+    ULONGLONG deadline = GetTickCount64() + timeout_ms;
+    LaunchStatus status = state.launch_status.load(std::memory_order_acquire);
+    while (status == LaunchStatus::launching && GetTickCount64() < deadline)
+    {
+        Sleep(10);
+        status = state.launch_status.load(std::memory_order_acquire);
+    }
+    return status;
+}
+
+void SetHostOffline(HostState &state, bool offline)
+{
+    char command[32];
+    char response[64];
+    sprintf_s(command, "set_offline %d\n", offline ? 1 : 0);
+    if (SendCommandToHost(state, command, response, sizeof(response)) && strncmp(response, "OK", 2) == 0)
+    {
+        state.offline_mode = offline;
+        DbgPrint(_T("Host switched to %hs processing."), offline ? "offline" : "realtime");
+    }
+    else
+    {
+        DbgPrint(_T("set_offline failed. Response: %hs"), response);
+    }
+}
+
+// 入力が無音で、それまでの入力の余韻と遅延の分をホストが出し切っていれば、ホストを起こさずに無音を出力できる。
+// トラックバーの値が変わったフレームは、変更をホストに届けるため処理する
+bool CanSkipSilentFrame(HostState &state, const ExEdit::Filter *efp)
+{
+    if (state.gui_visible)
+        return false;
+    if (state.pRing && static_cast<RingHeader *>(state.pRing)->eventCapacity > 0)
+    {
+        for (int lane = 0; lane < AUTOMATION_LANE_COUNT; ++lane)
+        {
+            if (efp->track[lane] >= 0 && efp->track[lane] != state.automation_values[lane])
+                return false;
+        }
+    }
+    // 問い合わせ直すまでは処理する。ここで問い合わせると音声の処理中にパイプの往復を待つことになる
+    if (state.tail_stale)
+        return false;
+    return state.tail_samples >= 0 && state.silent_run >= static_cast<int64_t>(state.tail_samples) + state.latency_samples;
+}
+
+BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip)
+{
+    auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
+    uint32_t object_id = static_cast<uint32_t>(efp->processing);
+    TRACE_SPAN("func_proc", object_id);
+
+    if (_tcslen(exdata->plugin_path) == 0 || efpip->audio_n == 0)
+    {
+        if (FindHostState(object_id))
+        {
+            DbgPrint(_T("Plugin path is empty, cleaning up leftover host for object %u."), object_id);
+            RemoveHostState(object_id);
+        }
+        return TRUE;
+    }
+
+    const bool exporting = g_exporting;
+    if (exporting)
+        g_export_stats.CountFrame(efpip->frame);
+    StartFrameBudget(efpip, exporting);
+    auto state_ptr = AcquireHostState(object_id, exdata);
+    auto &state = *state_ptr;
+    state.last_used_us = stats_page::NowUs();
+    state.frame_samples = efpip->audio_n;
+    stats_page::Add(state.stats->frames, 1);
+    if (state.temporarily_disabled)
+    {
+        stats_page::Add(state.stats->bypassFrames, 1);
+        if (exporting)
+            g_export_stats.dry_frames++;
+        return TRUE;
+    }
+    LaunchStatus status = state.launch_status.load(std::memory_order_acquire);
+    bool requested = false;
+    if (status == LaunchStatus::idle)
+    {
+        // 退避やクラッシュの前に取得した状態から起動する
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            ApplyPendingState(state, exdata);
+        }
+        if (state.launch_status.compare_exchange_strong(status, LaunchStatus::launching))
+        {
+            RequestHostLaunch(efp, efpip, state_ptr);
+            requested = true;
+        }
+        status = LaunchStatus::launching;
+    }
+    if (status == LaunchStatus::launching && exporting)
+    {
+        status = WaitForLaunch(state, g_export_timeout_ms);
+    }
+    else if (status == LaunchStatus::launching && requested && state.evicted)
+    {
+        // 退避したホストは、戻したフレームで一度だけ起動を待つ。間に合わなければ起動するまで素通しする
+        status = WaitForLaunch(state, RESTORE_WAIT_MS);
+    }
+    if (status != LaunchStatus::ready)
+    {
+        stats_page::Add(state.evicted ? state.stats->restoreBypassFrames : state.stats->bypassFrames, 1);
+        if (exporting)
+            g_export_stats.dry_frames++;
+        return TRUE;
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!IsHostReady(state))
+    {
+        stats_page::Add(state.stats->bypassFrames, 1);
+        if (exporting)
+            g_export_stats.dry_frames++;
+        return TRUE;
+    }
+    ApplyPendingState(state, exdata);
+    if (state.host_running && !IsHostAlive(state))
     {
         DbgPrint(_T("Host process for object %u has terminated unexpectedly. Handling crash..."), object_id);
 
@@ -310,6 +1386,7 @@ BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip)
             state.restart_attempts = 1;
         }
         state.last_crash_time = current_time;
+        stats_page::Add(state.stats->restarts, 1);
 
         DbgPrint(_T("Crash detected. Attempt count: %d"), (int)state.restart_attempts);
 
@@ -338,19 +1415,10 @@ BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip)
             return TRUE;
         }
     }
-    if (!state.host_running)
-    {
-        _tcscpy_s(state.loaded_plugin_path, MAX_PATH, exdata->plugin_path);
-        if (!LaunchHostProcess(efp, efpip, state))
-        {
-            DbgPrint(_T("func_proc: Host launch failed for obj %u. Bypassing."), object_id);
-            state.host_running = true;
-            state.pi.hProcess = INVALID_HANDLE_VALUE;
-            return TRUE;
-        }
-    }
-    if (!state.pSharedMem)
+    if (!state.pRing && !state.process->shared_mem.Data())
         return TRUE;
+    if ((state.process->host_caps & host_caps::offline) && state.offline_mode != exporting)
+        SetHostOffline(state, exporting);
 
     short *audio_in = (efp == &effect) ? efpip->audio_temp : efpip->audio_p;
     short *audio_out = (efp == &effect) ? efpip->audio_data : efpip->audio_p;
@@ -359,79 +1427,218 @@ BOOL func_proc(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip)
         memcpy(efpip->audio_temp, audio_in, efpip->audio_n * efpip->audio_ch * sizeof(short));
         audio_in = efpip->audio_temp;
     }
-    int total_samples = efpip->audio_n;
-    auto *shared_data = static_cast<AudioSharedData *>(state.pSharedMem);
-    auto *shared_buffer = reinterpret_cast<float *>(static_cast<char *>(state.pSharedMem) + sizeof(AudioSharedData));
+    const size_t total_samples = static_cast<size_t>(efpip->audio_n) * efpip->audio_ch;
+
+    // 無音の入力が続いている間だけ silent_run を伸ばす。シーク後はホストにシーク前の余韻が残っている
+    const bool contiguous = IsContiguous(state, efpip);
+    const bool input_silent = (state.process->host_caps & host_caps::tail) && audio_convert::IsSilent(audio_in, total_samples);
+    if (!input_silent || !contiguous)
+        state.silent_run = 0;
+    if (input_silent && contiguous && CanSkipSilentFrame(state, efp))
+    {
+        memset(audio_out, 0, total_samples * sizeof(short));
+        stats_page::Add(state.stats->silentBlocks, (efpip->audio_n + state.block_size - 1) / state.block_size);
+        state.silent_run += efpip->audio_n;
+        AdvancePosition(state, efpip, audio_in);
+        return TRUE;
+    }
 
-    for (int samples_processed = 0; samples_processed < total_samples;)
+    // GUI 表示中はプラグインの状態が exdata に反映されていないためキャッシュしない
+    const bool use_cache = g_audio_cache.Enabled() && !state.gui_visible;
+    audio_cache::Key cache_key = {};
+    if (use_cache)
     {
-        int samples_to_process = std::min(total_samples - samples_processed, MAX_BLOCK_SIZE);
-        float *in_l = shared_buffer;
-        float *in_r = shared_buffer + MAX_BLOCK_SIZE;
-        for (int i = 0; i < samples_to_process; ++i)
+        cache_key.object_id = object_id;
+        cache_key.frame = efpip->frame;
+        cache_key.milliframe = efpip->audio_milliframe;
+        cache_key.samples = efpip->audio_n;
+        cache_key.channels = efpip->audio_ch;
+        cache_key.input_hash = audio_cache::Hash(audio_in, total_samples * sizeof(short));
+        cache_key.config_hash = audio_cache::Hash(exdata->state_b64, strlen(exdata->state_b64),
+                                                  audio_cache::Hash(state.loaded_chain.data(), state.loaded_chain.size() * sizeof(TCHAR)));
+        if (state.pRing && static_cast<RingHeader *>(state.pRing)->eventCapacity > 0)
+            cache_key.config_hash = audio_cache::Hash(efp->track, AUTOMATION_LANE_COUNT * sizeof(efp->track[0]), cache_key.config_hash);
+        if (g_audio_cache.Lookup(cache_key, audio_out, total_samples))
         {
-            if (efpip->audio_ch == 2)
-            {
-                in_l[i] = static_cast<float>(audio_in[(samples_processed + i) * 2]) / 32768.0f;
-                in_r[i] = static_cast<float>(audio_in[(samples_processed + i) * 2 + 1]) / 32768.0f;
-            }
-            else
-            {
-                in_l[i] = static_cast<float>(audio_in[samples_processed + i]) / 32768.0f;
-                in_r[i] = in_l[i];
-            }
+            AdvancePosition(state, efpip, audio_in);
+            return TRUE;
         }
-        shared_data->sampleRate = efpip->audio_rate;
-        shared_data->numSamples = samples_to_process;
-        shared_data->numChannels = efpip->audio_ch;
-        ResetEvent(state.hEventHostDone);
-        SetEvent(state.hEventClientReady);
-        DWORD waitResult = WaitForSingleObject(state.hEventHostDone, 500);
+    }
+
+    // 途中で待ちきれずに素通しするより、予算に収まらないオブジェクトは最初から素通しする
+    if (ExceedsFrameBudget(state, efpip->audio_n))
+    {
+        DbgPrint(_T("Frame %d budget exhausted. Bypassing object %u."), efpip->frame, object_id);
+        state.round_trip.Decay();
+        stats_page::Add(state.stats->budgetBypassFrames, 1);
+        if (exporting)
+            g_export_stats.dry_frames++;
+        if (audio_out != audio_in)
+            memcpy(audio_out, audio_in, total_samples * sizeof(short));
+        AdvancePosition(state, efpip, audio_in);
+        return TRUE;
+    }
+
+    if (g_preroll_ms > 0 && !contiguous)
+        RunPreroll(state, efpip);
+    // プリロールには前回までの値が使われ、イベントは聞こえる最初のブロックから適用される
+    if (state.pRing && static_cast<RingHeader *>(state.pRing)->eventCapacity > 0)
+    {
+        BuildAutomationEvents(state, efp, efpip->audio_n, contiguous);
+        if (!state.automation_events.empty())
+            MarkTailStale(state);
+    }
+    AdvancePosition(state, efpip, audio_in);
+
+    int samples_done = 0;
+    BlockResult result = state.pRing ? ProcessBlocksRing(state, efpip, audio_in, audio_out, samples_done)
+                                     : ProcessBlocksLegacy(state, efpip, audio_in, audio_out, samples_done);
+    state.automation_events.clear();
+    state.silent_run = (result == BlockResult::ok && input_silent) ? state.silent_run + efpip->audio_n : 0;
+    if (result == BlockResult::timed_out)
+        stats_page::Add(state.stats->timeouts, 1);
+    if (result != BlockResult::ok && exporting)
+        g_export_stats.fallback_frames++;
+    if (result == BlockResult::host_lost)
+    {
+        DbgPrint(_T("Host appears to have terminated during processing. Crash will be handled on the next frame."));
+    }
+    else if (result == BlockResult::timed_out)
+    {
+        DbgPrint(_T("Host processing timed out/failed. Bypassing from sample %d."), samples_done);
+        int channels = efpip->audio_ch;
+        memcpy(audio_out + samples_done * channels, audio_in + samples_done * channels, (efpip->audio_n - samples_done) * channels * sizeof(short));
+    }
+    else if (use_cache)
+    {
+        g_audio_cache.Insert(cache_key, audio_out, total_samples);
+    }
+    return TRUE;
+}
+
+void WriteTraceFile()
+{
+    FILE *out = nullptr;
+    if (_tfopen_s(&out, g_trace_path, _T("w")) != 0 || !out)
+    {
+        DbgPrint(_T("Failed to open trace file %s."), g_trace_path);
+        return;
+    }
+    bool ok = trace::WriteChromeTrace(out);
+    fclose(out);
+    DbgPrint(_T("Trace written to %s (%hs, %llu events dropped)."), g_trace_path, ok ? "ok" : "write error", trace::Dropped());
+}
 
-        if (waitResult == WAIT_OBJECT_0)
+BOOL func_init(ExEdit::Filter *efp)
+{
+    DbgPrint(_T("Sample conversion ISA: %d"), static_cast<int>(audio_convert::ActiveIsa()));
+    LoadSettings();
+    trace::SetThreadName("main");
+    if (!g_stats_page.Open())
+        DbgPrint(_T("Failed to open the stats page: %lu"), GetLastError());
+    StartHostPool();
+    StartStateSync();
+    StartHostEvictor();
+    return TRUE;
+}
+BOOL func_exit(ExEdit::Filter *efp)
+{
+    DbgPrint(_T("Filter exiting. Cleaning up all host processes."));
+    DbgPrint(_T("Audio cache: %llu hits, %llu misses, %zu bytes."), g_audio_cache.Hits(), g_audio_cache.Misses(), g_audio_cache.BytesUsed());
+    StopHostEvictor();
+    StopStateSync();
+    StopHostLauncher();
+    StopHostPool();
+    g_host_states.Clear();
+    g_stats_page.Close();
+    if (trace::Enabled())
+        WriteTraceFile();
+    return TRUE;
+}
+// 関連付けられた拡張子で絞り込んだファイル選択ダイアログ。path は MAX_PATH 文字
+bool ChoosePluginFile(ExEdit::Filter *efp, TCHAR *path)
+{
+    TCHAR aviutl_dir[MAX_PATH];
+    GetModuleFileName(NULL, aviutl_dir, MAX_PATH);
+    TCHAR *last_slash = _tcsrchr(aviutl_dir, _T('\\'));
+    if (!last_slash)
+        return false;
+    *(last_slash + 1) = _T('\0');
+    TCHAR ini_path[MAX_PATH];
+    _stprintf_s(ini_path, _T("%s%s\\%s"), aviutl_dir, _T("audio_exe"), _T("audio_plugin_link.ini"));
+    TCHAR final_filter[2048] = {0};
+    TCHAR *p = final_filter;
+    const TCHAR *p_end = final_filter + (sizeof(final_filter) / sizeof(TCHAR)) - 2;
+    TCHAR combined_exts[512] = {0};
+    if (GetFileAttributes(ini_path) != INVALID_FILE_ATTRIBUTES)
+    {
+        TCHAR all_keys[2048];
+        DWORD bytes_read = GetPrivateProfileString(_T("Mappings"), NULL, _T(""), all_keys, sizeof(all_keys) / sizeof(TCHAR), ini_path);
+        if (bytes_read > 0)
         {
-            float *out_l = shared_buffer + 2 * MAX_BLOCK_SIZE;
-            float *out_r = shared_buffer + 3 * MAX_BLOCK_SIZE;
-            for (int i = 0; i < samples_to_process; ++i)
+            const TCHAR *current_key = all_keys;
+            while (*current_key)
             {
-                float sample_l = std::clamp(out_l[i], -1.0f, 1.0f);
-                float sample_r = std::clamp(out_r[i], -1.0f, 1.0f);
-                if (efpip->audio_ch == 2)
-                {
-                    audio_out[(samples_processed + i) * 2] = static_cast<short>(sample_l * 32767.0f);
-                    audio_out[(samples_processed + i) * 2 + 1] = static_cast<short>(sample_r * 32767.0f);
-                }
-                else
+                if (_tcslen(combined_exts) > 0)
                 {
-                    audio_out[samples_processed + i] = static_cast<short>(((sample_l + sample_r) * 0.5f) * 32767.0f);
+                    _tcscat_s(combined_exts, _T(";"));
                 }
+                _tcscat_s(combined_exts, _T("*"));
+                _tcscat_s(combined_exts, current_key);
+                current_key += _tcslen(current_key) + 1;
             }
-        }
-        else
-        {
-            DbgPrint(_T("Host processing timed out/failed (result: %lu). Bypassing."), waitResult);
-            if (!IsHostAlive(state))
+            int len = _stprintf_s(p, p_end - p, _T("Audio Plugins (%s)"), combined_exts);
+            p += len + 1;
+            len = _stprintf_s(p, p_end - p, _T("%s"), combined_exts);
+            p += len + 1;
+            current_key = all_keys;
+            while (*current_key)
             {
-                DbgPrint(_T("Host appears to have terminated during processing. Crash will be handled on the next frame."));
-                return TRUE;
+                TCHAR ext_upper[32];
+                _tcscpy_s(ext_upper, current_key + 1);
+                _tcsupr_s(ext_upper);
+                len = _stprintf_s(p, p_end - p, _T("%s Plugins (*%s)"), ext_upper, current_key);
+                p += len + 1;
+                len = _stprintf_s(p, p_end - p, _T("*%s"), current_key);
+                p += len + 1;
+                current_key += _tcslen(current_key) + 1;
             }
-            memcpy(audio_out + samples_processed * efpip->audio_ch, audio_in + samples_processed * efpip->audio_ch, samples_to_process * efpip->audio_ch * sizeof(short));
-            break;
         }
-        samples_processed += samples_to_process;
     }
-
-    return TRUE;
+    int len = _stprintf_s(p, p_end - p, _T("Executable Host (*.exe)"));
+    p += len + 1;
+    len = _stprintf_s(p, p_end - p, _T("*.exe"));
+    p += len + 1;
+    len = _stprintf_s(p, p_end - p, _T("All Files (*.*)"));
+    p += len + 1;
+    len = _stprintf_s(p, p_end - p, _T("*.*"));
+    p += len + 1;
+    *p = _T('\0');
+    OPENFILENAME ofn = {0};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = efp->exedit_fp->hwnd;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrFilter = final_filter;
+    ofn.nFilterIndex = 1;
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
+    path[0] = _T('\0');
+    if (GetOpenFileName(&ofn))
+    {
+        DbgPrint(_T("File selected: %s"), path);
+        return true;
+    }
+    if (CommDlgExtendedError() != 0)
+    {
+        DbgPrint(_T("GetOpenFileName failed with error: %ld"), CommDlgExtendedError());
+    }
+    else
+    {
+        DbgPrint(_T("GetOpenFileName cancelled by user."));
+    }
+    return false;
 }
 
-BOOL func_init(ExEdit::Filter *efp) { return TRUE; }
-BOOL func_exit(ExEdit::Filter *efp)
-{
-    DbgPrint(_T("Filter exiting. Cleaning up all host processes."));
-    std::lock_guard<std::mutex> lock(g_states_mutex);
-    g_host_states.clear();
-    return TRUE;
-}
 BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl::EditHandle *editp, ExEdit::Filter *efp)
 {
     if (message == WM_APP_UPDATE_GUI)
@@ -440,10 +1647,67 @@ BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl:
         efp->exedit_fp->exfunc->filter_window_update(efp->exedit_fp);
         return TRUE;
     }
+    if (message == WM_APP_STATE_SYNCED)
+    {
+        // 設定ダイアログに表示中のオブジェクトなら、再生を待たずに exdata へ書き込む
+        uint32_t object_id = static_cast<uint32_t>(wparam);
+        if (static_cast<uint32_t>(efp->processing) != object_id || !efp->exdata_ptr)
+            return FALSE;
+        auto state_ptr = FindHostState(object_id);
+        if (!state_ptr)
+            return FALSE;
+        std::lock_guard<std::mutex> lock(state_ptr->mutex);
+        auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
+        if (ApplyPendingState(*state_ptr, exdata))
+            DbgPrint(_T("Applied synced state for object %u."), object_id);
+        PinStoredState(*state_ptr, exdata->state_b64);
+        return TRUE;
+    }
+    if (message == WM_APP_LAUNCH_FAILED)
+    {
+        // フィルタとエフェクトの両方に届くため、取り出した方だけが表示する
+        auto state_ptr = FindHostState(static_cast<uint32_t>(wparam));
+        if (!state_ptr)
+            return FALSE;
+        std::basic_string<TCHAR> title, text;
+        {
+            std::lock_guard<std::mutex> lock(state_ptr->mutex);
+            title.swap(state_ptr->launch_error_title);
+            text.swap(state_ptr->launch_error);
+        }
+        if (text.empty())
+            return FALSE;
+        MessageBox(efp->exedit_fp->hwnd, text.c_str(), title.c_str(), MB_OK | MB_ICONERROR);
+        return TRUE;
+    }
     if (message == AviUtl::FilterPlugin::WindowMessage::SaveStart)
     {
         DbgPrint(_T("WM_EXTENDEDFILTER_SAVE_START received. Checking if state needs to be saved."));
         SaveStateIfGuiVisible(efp);
+        if (!g_exporting.exchange(true))
+        {
+            g_export_stats.Reset();
+        }
+        return TRUE;
+    }
+    if (message == AviUtl::FilterPlugin::WindowMessage::SaveEnd)
+    {
+        if (g_exporting.exchange(false))
+        {
+            uint32_t dry = g_export_stats.dry_frames;
+            uint32_t fallback = g_export_stats.fallback_frames;
+            DbgPrint(_T("Export finished. Frames: %u, object frames: %u, dry: %u, fallback: %u"),
+                     g_export_stats.frames.load(), g_export_stats.object_frames.load(), dry, fallback);
+            if (dry > 0 || fallback > 0)
+            {
+                TCHAR msg[384];
+                _stprintf_s(msg, _T("書き出した %u フレーム（オブジェクトごとに延べ %u フレーム）のうち、")
+                                 _T("延べ %u フレームでプラグインの処理が行われず、%u フレームで処理が途中で打ち切られました。\n")
+                                 _T("該当部分には未処理の音声が出力されています。"),
+                            g_export_stats.frames.load(), g_export_stats.object_frames.load(), dry, fallback);
+                MessageBox(efp->exedit_fp->hwnd, msg, FILTER_NAME, MB_OK | MB_ICONWARNING);
+            }
+        }
         return TRUE;
     }
     if (message != ExEdit::ExtendedFilter::Message::WM_EXTENDEDFILTER_COMMAND)
@@ -458,118 +1722,70 @@ BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl:
     case idx_check::select_plugin:
     {
         DbgPrint(_T("Button 'select_plugin' clicked."));
-        TCHAR aviutl_dir[MAX_PATH];
-        GetModuleFileName(NULL, aviutl_dir, MAX_PATH);
-        TCHAR *last_slash = _tcsrchr(aviutl_dir, _T('\\'));
-        if (!last_slash)
-            break;
-        *(last_slash + 1) = _T('\0');
-        TCHAR ini_path[MAX_PATH];
-        _stprintf_s(ini_path, _T("%s%s\\%s"), aviutl_dir, _T("audio_exe"), _T("audio_plugin_link.ini"));
-        TCHAR final_filter[2048] = {0};
-        TCHAR *p = final_filter;
-        const TCHAR *p_end = final_filter + (sizeof(final_filter) / sizeof(TCHAR)) - 2;
-        TCHAR combined_exts[512] = {0};
-        if (GetFileAttributes(ini_path) != INVALID_FILE_ATTRIBUTES)
-        {
-            TCHAR all_keys[2048];
-            DWORD bytes_read = GetPrivateProfileString(_T("Mappings"), NULL, _T(""), all_keys, sizeof(all_keys) / sizeof(TCHAR), ini_path);
-            if (bytes_read > 0)
-            {
-                const TCHAR *current_key = all_keys;
-                while (*current_key)
-                {
-                    if (_tcslen(combined_exts) > 0)
-                    {
-                        _tcscat_s(combined_exts, _T(";"));
-                    }
-                    _tcscat_s(combined_exts, _T("*"));
-                    _tcscat_s(combined_exts, current_key);
-                    current_key += _tcslen(current_key) + 1;
-                }
-                int len = _stprintf_s(p, p_end - p, _T("Audio Plugins (%s)"), combined_exts);
-                p += len + 1;
-                len = _stprintf_s(p, p_end - p, _T("%s"), combined_exts);
-                p += len + 1;
-                current_key = all_keys;
-                while (*current_key)
-                {
-                    TCHAR ext_upper[32];
-                    _tcscpy_s(ext_upper, current_key + 1);
-                    _tcsupr_s(ext_upper);
-                    len = _stprintf_s(p, p_end - p, _T("%s Plugins (*%s)"), ext_upper, current_key);
-                    p += len + 1;
-                    len = _stprintf_s(p, p_end - p, _T("*%s"), current_key);
-                    p += len + 1;
-                    current_key += _tcslen(current_key) + 1;
-                }
-            }
-        }
-        int len = _stprintf_s(p, p_end - p, _T("Executable Host (*.exe)"));
-        p += len + 1;
-        len = _stprintf_s(p, p_end - p, _T("*.exe"));
-        p += len + 1;
-        len = _stprintf_s(p, p_end - p, _T("All Files (*.*)"));
-        p += len + 1;
-        len = _stprintf_s(p, p_end - p, _T("*.*"));
-        p += len + 1;
-        *p = _T('\0');
-        TCHAR szFile[MAX_PATH] = {0};
-        OPENFILENAME ofn = {0};
-        ofn.lStructSize = sizeof(ofn);
-        ofn.hwndOwner = efp->exedit_fp->hwnd;
-        ofn.lpstrFile = szFile;
-        ofn.nMaxFile = sizeof(szFile) / sizeof(TCHAR);
-        ofn.lpstrFilter = final_filter;
-        ofn.nFilterIndex = 1;
-        ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
-        if (GetOpenFileName(&ofn))
-        {
-            DbgPrint(_T("File selected: %s"), szFile);
+        TCHAR szFile[MAX_PATH];
+        if (ChoosePluginFile(efp, szFile))
+        {
             efp->exfunc->set_undo(efp->processing, 0);
-            {
-                std::lock_guard<std::mutex> lock(g_states_mutex);
-                g_host_states.erase(object_id);
-            }
+            RemoveHostState(object_id);
             _tcscpy_s(exdata->plugin_path, MAX_PATH, szFile);
             exdata->state_b64[0] = '\0';
+            ClearChain(exdata);
             needs_update = true;
         }
-        else
-        {
-            if (CommDlgExtendedError() != 0)
-            {
-                DbgPrint(_T("GetOpenFileName failed with error: %ld"), CommDlgExtendedError());
-            }
-            else
-            {
-                DbgPrint(_T("GetOpenFileName cancelled by user."));
-            }
-        }
         break;
     }
-    case idx_check::toggle_gui:
+    case idx_check::append_plugin:
     {
-        DbgPrint(_T("Button 'toggle_gui' clicked."));
-        std::unique_lock<std::mutex> lock(g_states_mutex);
-        auto it = g_host_states.find(object_id);
-        if (it == g_host_states.end() || !it->second->host_running)
+        DbgPrint(_T("Button 'append_plugin' clicked."));
+        const int length = ChainLength(exdata);
+        if (_tcslen(exdata->plugin_path) == 0)
         {
-            lock.unlock();
-            MessageBox(efp->exedit_fp->hwnd, _T("ホストが起動していません。\n編集中に一度再生すると起動します。"), _T("情報"), MB_OK | MB_ICONINFORMATION);
+            MessageBox(efp->exedit_fp->hwnd, _T("先に「プラグインを選択」で最初のプラグインを選択してください。"), _T("情報"), MB_OK | MB_ICONINFORMATION);
             return TRUE;
         }
-        auto &state = *it->second;
-        if (state.temporarily_disabled)
+        if (length == MAX_CHAIN_PLUGINS - 1)
         {
-            lock.unlock();
-            MessageBox(efp->exedit_fp->hwnd, _T("ホストは繰り返しクラッシュしたため無効化されています。\nプラグインを再選択してください。"), _T("エラー"), MB_OK | MB_ICONERROR);
+            MessageBox(efp->exedit_fp->hwnd, _T("これ以上プラグインを追加できません。"), _T("情報"), MB_OK | MB_ICONINFORMATION);
             return TRUE;
         }
-        if (!IsHostAlive(state))
+        TCHAR szFile[MAX_PATH];
+        if (ChoosePluginFile(efp, szFile))
         {
-            lock.unlock();
-            MessageBox(efp->exedit_fp->hwnd, _T("ホストプロセスが応答しません。クラッシュした可能性があります。\n再生を再開すると、ホストの再起動が試みられます。"), _T("エラー"), MB_OK | MB_ICONERROR);
+            // 段数が変わると保存済みの状態はそのまま使えないため、選択し直したときと同じく破棄する
+            efp->exfunc->set_undo(efp->processing, 0);
+            RemoveHostState(object_id);
+            exdata->state_b64[0] = '\0';
+            SetChainPath(exdata, length, szFile);
+            needs_update = true;
+        }
+        break;
+    }
+    case idx_check::toggle_gui:
+    {
+        DbgPrint(_T("Button 'toggle_gui' clicked."));
+        auto state_ptr = FindHostState(object_id);
+        if (state_ptr && state_ptr->launch_status == LaunchStatus::launching)
+        {
+            MessageBox(efp->exedit_fp->hwnd, _T("ホストを起動しています。\nしばらく待ってから再度お試しください。"), _T("情報"), MB_OK | MB_ICONINFORMATION);
+            return TRUE;
+        }
+        if (!state_ptr || !IsHostReady(*state_ptr))
+        {
+            MessageBox(efp->exedit_fp->hwnd, _T("ホストが起動していません。\n編集中に一度再生すると起動します。"), _T("情報"), MB_OK | MB_ICONINFORMATION);
+            return TRUE;
+        }
+        auto &state = *state_ptr;
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if (state.temporarily_disabled)
+        {
+            lock.unlock();
+            MessageBox(efp->exedit_fp->hwnd, _T("ホストは繰り返しクラッシュしたため無効化されています。\nプラグインを再選択してください。"), _T("エラー"), MB_OK | MB_ICONERROR);
+            return TRUE;
+        }
+        if (!IsHostAlive(state))
+        {
+            lock.unlock();
+            MessageBox(efp->exedit_fp->hwnd, _T("ホストプロセスが応答しません。クラッシュした可能性があります。\n再生を再開すると、ホストの再起動が試みられます。"), _T("エラー"), MB_OK | MB_ICONERROR);
             return TRUE;
         }
         bool is_hiding = state.gui_visible;
@@ -585,6 +1801,8 @@ BOOL func_WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam, AviUtl:
                 lock.lock();
             }
             state.gui_visible = !is_hiding;
+            if (is_hiding)
+                MarkTailStale(state);
             needs_update = true;
         }
         else
@@ -619,7 +1837,7 @@ int32_t func_window_init(HINSTANCE, HWND, int, int, int, ExEdit::Filter *efp)
     HWND hStaticPath = efp->exfunc->get_hwnd(efp->processing, 5, idx_check::select_plugin);
     if (hStaticPath)
     {
-        TCHAR display_path[MAX_PATH];
+        TCHAR display_path[MAX_PATH * 2];
         if (_tcslen(exdata->plugin_path) == 0)
         {
             _tcscpy_s(display_path, _T("（プラグイン未選択）"));
@@ -628,19 +1846,41 @@ int32_t func_window_init(HINSTANCE, HWND, int, int, int, ExEdit::Filter *efp)
         {
             const TCHAR *filename = _tcsrchr(exdata->plugin_path, _T('\\'));
             _tcscpy_s(display_path, filename ? filename + 1 : exdata->plugin_path);
+            // 遅延の表示の分を残して、収まる段まで表示する
+            for (int i = 0; i < ChainLength(exdata); ++i)
+            {
+                filename = _tcsrchr(ChainPath(exdata, i), _T('\\'));
+                const TCHAR *name = filename ? filename + 1 : ChainPath(exdata, i);
+                if (_tcslen(display_path) + _tcslen(name) + 96 >= std::size(display_path))
+                    break;
+                _tcscat_s(display_path, _T(" → "));
+                _tcscat_s(display_path, name);
+            }
+            // 遅延を報告するプラグインはオブジェクトをこの分だけ前にずらして合わせる。
+            // 拡張編集は先の入力を渡さないため、func_proc の中では補正できない
+            auto state = FindHostState(object_id);
+            if (state && IsHostReady(*state) && state->latency_samples > 0 && state->sample_rate > 0)
+            {
+                TCHAR latency_text[96];
+                _stprintf_s(latency_text, _T(" (遅延 %d smp / %.1f ms"), state->latency_samples.load(), state->latency_samples * 1000.0 / state->sample_rate);
+                if (state->frame_samples > 0)
+                {
+                    TCHAR frames_text[32];
+                    _stprintf_s(frames_text, _T(" / %.2f フレーム"), static_cast<double>(state->latency_samples) / state->frame_samples);
+                    _tcscat_s(latency_text, frames_text);
+                }
+                _tcscat_s(latency_text, _T(")"));
+                _tcscat_s(display_path, latency_text);
+            }
         }
         SetWindowText(hStaticPath, display_path);
     }
     bool gui_is_visible = false;
     bool is_disabled = false;
+    if (auto state = FindHostState(object_id))
     {
-        std::lock_guard<std::mutex> lock(g_states_mutex);
-        if (g_host_states.count(object_id))
-        {
-            auto &state = g_host_states.at(object_id);
-            gui_is_visible = state->gui_visible;
-            is_disabled = state->temporarily_disabled;
-        }
+        gui_is_visible = state->gui_visible;
+        is_disabled = state->temporarily_disabled;
     }
     HWND hBtnGui = efp->exfunc->get_hwnd(efp->processing, 4, idx_check::toggle_gui);
     if (hBtnGui)
@@ -658,194 +1898,1420 @@ int32_t func_window_init(HINSTANCE, HWND, int, int, int, ExEdit::Filter *efp)
     }
     return 0;
 }
-bool ConnectIPC(HostState &state)
+// IPC オブジェクトの名前 "<base>_<unique_id><suffix>"。ホストにも同じ規則で渡している
+void FormatIpcName(char *dst, size_t dst_size, const TCHAR *base, uint64_t unique_id, const char *suffix = "")
+{
+    char base_mb[MAX_PATH];
+    ToUtf8(base, base_mb, MAX_PATH);
+    sprintf_s(dst, dst_size, "%s_%llu%s", base_mb, unique_id, suffix);
+}
+
+bool ConnectIPC(HostProcess &process)
 {
-    TCHAR name[MAX_PATH];
-    _stprintf_s(name, _T("%s_%llu"), PIPE_NAME_BASE, state.unique_id);
-    for (int i = 0; i < 50; ++i)
+    TRACE_SPAN("ConnectIPC");
+    char name[MAX_PATH];
+    FormatIpcName(name, sizeof(name), PIPE_NAME_BASE, process.unique_id);
+    if (!process.pipe.Connect(name, PIPE_CONNECT_TIMEOUT_MS))
     {
-        state.hPipe = CreateFile(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-        if (state.hPipe != INVALID_HANDLE_VALUE)
-            break;
-        if (GetLastError() == ERROR_PIPE_BUSY)
-            WaitNamedPipe(name, 1000);
-        else
-            Sleep(100);
+        DbgPrint(_T("Pipe open timed out."));
+        return false;
     }
-    if (state.hPipe == INVALID_HANDLE_VALUE)
+    FormatIpcName(name, sizeof(name), SHARED_MEM_NAME_BASE, process.unique_id);
+    if (!process.shared_mem.Open(name, SHARED_MEM_TOTAL_SIZE))
     {
-        DbgPrint(_T("Pipe open timed out."));
+        DbgPrint(_T("Opening shared memory failed: %lu"), ipc_transport::LastError());
+        return false;
+    }
+    FormatIpcName(name, sizeof(name), EVENT_CLIENT_READY_NAME_BASE, process.unique_id);
+    bool opened = process.client_ready.Open(name);
+    FormatIpcName(name, sizeof(name), EVENT_HOST_DONE_NAME_BASE, process.unique_id);
+    opened = process.host_done.Open(name) && opened;
+    if (!opened)
+    {
+        DbgPrint(_T("Opening events failed: %lu"), ipc_transport::LastError());
+        return false;
+    }
+    return true;
+}
+
+bool GetAudioExePaths(TCHAR *audio_exe_dir, TCHAR *ini_path)
+{
+    TCHAR aviutl_dir[MAX_PATH];
+    GetModuleFileName(NULL, aviutl_dir, MAX_PATH);
+    TCHAR *last_slash = _tcsrchr(aviutl_dir, _T('\\'));
+    if (!last_slash)
+        return false;
+    *(last_slash + 1) = _T('\0');
+    _stprintf_s(audio_exe_dir, MAX_PATH, _T("%s%s"), aviutl_dir, _T("audio_exe"));
+    _stprintf_s(ini_path, MAX_PATH, _T("%s\\%s"), audio_exe_dir, _T("audio_plugin_link.ini"));
+    return true;
+}
+
+void ToUtf8(const TCHAR *src, char *dst, int dst_size)
+{
+#ifdef UNICODE
+    WideCharToMultiByte(CP_UTF8, 0, src, -1, dst, dst_size, NULL, NULL);
+#else
+    strcpy_s(dst, dst_size, src);
+#endif
+}
+
+void QueryHostCapabilities(HostProcess &process)
+{
+    process.host_caps = 0;
+    process.host_max_block_size = 0;
+    char response[256];
+    if (!SendCommandToProcess(process, "get_capabilities\n", response, sizeof(response)) || strncmp(response, "OK", 2) != 0)
+    {
+        DbgPrint(_T("Host does not report capabilities. Using legacy protocol."));
+        return;
+    }
+    char *context = nullptr;
+    for (char *token = strtok_s(response + 2, " \r\n", &context); token; token = strtok_s(nullptr, " \r\n", &context))
+    {
+        if (strncmp(token, "max_block=", 10) == 0)
+        {
+            process.host_max_block_size = static_cast<uint32_t>(strtoul(token + 10, nullptr, 10));
+            continue;
+        }
+        for (const auto &known : host_caps::tokens)
+        {
+            if (strcmp(token, known.name) == 0)
+                process.host_caps |= known.flag;
+        }
+    }
+    DbgPrint(_T("Host capabilities: 0x%08X, max_block=%u"), process.host_caps, process.host_max_block_size);
+}
+
+// リングに対応していないホストは従来どおり MAX_BLOCK_SIZE 固定
+int NegotiateBlockSize(const HostProcess &process, int frame_samples)
+{
+    if (!(process.host_caps & host_caps::ring))
+        return MAX_BLOCK_SIZE;
+    return NegotiateRingBlockSize(frame_samples, process.host_max_block_size);
+}
+
+uint32_t RingEventCapacity(const HostProcess &process)
+{
+    return (process.host_caps & host_caps::automation) ? AUTOMATION_EVENT_CAPACITY : 0;
+}
+
+void InitRingHeader(void *ring, const HostProcess &process, uint32_t block_size, uint32_t channel_count)
+{
+    auto *header = static_cast<RingHeader *>(ring);
+    header->version = RING_LAYOUT_VERSION;
+    header->slotCount = RING_SLOT_COUNT;
+    header->blockSize = block_size;
+    header->slotStride = static_cast<uint32_t>(RingSlotStride(block_size, channel_count, RingEventCapacity(process)));
+    header->channelCount = channel_count;
+    header->stateSerial = 0;
+    header->eventCapacity = RingEventCapacity(process);
+    // 単一コアではスピンしても相手が進まないため、イベント方式のままにする
+    bool use_spin = (process.host_caps & host_caps::spin) && std::thread::hardware_concurrency() > 1;
+    header->signalMode = use_spin ? ring_signal::spin : ring_signal::event;
+}
+
+bool AttachRing(HostState &state)
+{
+    char name[MAX_PATH];
+    FormatIpcName(name, sizeof(name), SHARED_MEM_NAME_BASE, state.process->unique_id, "_ring");
+    const uint32_t block_size = static_cast<uint32_t>(state.block_size);
+    const uint32_t channel_count = static_cast<uint32_t>(state.channel_count);
+    const size_t mapping_size = RingMappingSize(RING_SLOT_COUNT, block_size, channel_count, RingEventCapacity(*state.process));
+    if (!state.ring_shm.Create(name, mapping_size))
+    {
+        DbgPrint(_T("Creating shared memory for ring failed: %lu"), ipc_transport::LastError());
+        return false;
+    }
+    void *ring = state.ring_shm.Data();
+    InitRingHeader(ring, *state.process, block_size, channel_count);
+
+    char command[MAX_PATH + 64];
+    sprintf_s(command, "attach_ring \"%s\" %u %u %u\n", name, RING_SLOT_COUNT, block_size, channel_count);
+    char response[256];
+    if (!SendCommandToHost(state, command, response, sizeof(response)) || strncmp(response, "OK", 2) != 0)
+    {
+        DbgPrint(_T("Host rejected ring transport. Response: %hs"), response);
+        state.ring_shm.Close();
+        return false;
+    }
+    state.pRing = ring;
+    state.ring_seq = 0;
+    state.ring_collected = 0;
+    return true;
+}
+
+bool CreateArena(HostProcess &process)
+{
+    FormatIpcName(process.arena_name, sizeof(process.arena_name), SHARED_MEM_NAME_BASE, process.unique_id, "_arena");
+    if (!process.arena.Create(process.arena_name, SHARED_ARENA_SIZE))
+    {
+        DbgPrint(_T("Creating shared memory for arena failed: %lu"), ipc_transport::LastError());
         return false;
     }
-    _stprintf_s(name, _T("%s_%llu"), SHARED_MEM_NAME_BASE, state.unique_id);
-    state.hShm = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, name);
-    if (!state.hShm)
+    process.ResetArena(SHARED_ARENA_SIZE);
+    return true;
+}
+
+// 共有ホストプロセスのアリーナ内にリングを確保し、インスタンス専用のイベントと合わせてホストに通知する
+bool AttachInstanceRing(HostState &state)
+{
+    HostProcess &process = *state.process;
+    const uint32_t block_size = static_cast<uint32_t>(state.block_size);
+    const uint32_t channel_count = static_cast<uint32_t>(state.channel_count);
+    const size_t ring_size = RingMappingSize(RING_SLOT_COUNT, block_size, channel_count, RingEventCapacity(process));
+    size_t offset = process.AllocateRegion(ring_size);
+    if (offset == SIZE_MAX)
     {
-        DbgPrint(_T("OpenFileMapping failed: %lu"), GetLastError());
+        DbgPrint(_T("Shared arena exhausted (%zu bytes requested)."), ring_size);
         return false;
     }
-    state.pSharedMem = MapViewOfFile(state.hShm, FILE_MAP_ALL_ACCESS, 0, 0, SHARED_MEM_TOTAL_SIZE);
-    if (!state.pSharedMem)
+    state.arena_offset = offset;
+    state.arena_size = ring_size;
+    void *ring = static_cast<char *>(process.arena.Data()) + offset;
+    memset(ring, 0, ring_size);
+    InitRingHeader(ring, process, block_size, channel_count);
+
+    char suffix[32];
+    char ready_name[MAX_PATH];
+    char done_name[MAX_PATH];
+    sprintf_s(suffix, "_%d", state.instance_id);
+    FormatIpcName(ready_name, sizeof(ready_name), EVENT_CLIENT_READY_NAME_BASE, process.unique_id, suffix);
+    FormatIpcName(done_name, sizeof(done_name), EVENT_HOST_DONE_NAME_BASE, process.unique_id, suffix);
+    if (!state.instance_ready.Create(ready_name) || !state.instance_done.Create(done_name))
     {
-        DbgPrint(_T("MapViewOfFile failed: %lu"), GetLastError());
+        DbgPrint(_T("Creating events for instance %d failed: %lu"), state.instance_id, ipc_transport::LastError());
         return false;
     }
-    _stprintf_s(name, _T("%s_%llu"), EVENT_CLIENT_READY_NAME_BASE, state.unique_id);
-    state.hEventClientReady = OpenEvent(EVENT_ALL_ACCESS, FALSE, name);
-    _stprintf_s(name, _T("%s_%llu"), EVENT_HOST_DONE_NAME_BASE, state.unique_id);
-    state.hEventHostDone = OpenEvent(EVENT_ALL_ACCESS, FALSE, name);
-    if (!state.hEventClientReady || !state.hEventHostDone)
+    state.client_ready = &state.instance_ready;
+    state.host_done = &state.instance_done;
+
+    char command[MAX_PATH * 3 + 128];
+    sprintf_s(command, "attach_ring \"%s\" %u %u %u %zu \"%s\" \"%s\"\n", process.arena_name, RING_SLOT_COUNT, block_size, channel_count, offset, ready_name, done_name);
+    char response[256];
+    if (!SendCommandToHost(state, command, response, sizeof(response)) || strncmp(response, "OK", 2) != 0)
     {
-        DbgPrint(_T("OpenEvent failed: %lu"), GetLastError());
+        DbgPrint(_T("Host rejected instance ring. Response: %hs"), response);
         return false;
     }
+    state.pRing = ring;
+    state.ring_seq = 0;
+    state.ring_collected = 0;
     return true;
 }
 
-bool LaunchHostProcess(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip, HostState &state)
+void QueryPluginIoConfig(HostState &state)
 {
-    auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
+    char response[256];
+    if (!SendCommandToHost(state, "get_io_config\n", response, sizeof(response)) ||
+        sscanf_s(response, "OK %d %d", &state.plugin_inputs, &state.plugin_outputs) != 2)
+    {
+        state.plugin_inputs = state.plugin_outputs = 0;
+        return;
+    }
+    DbgPrint(_T("Plugin native I/O: %d in / %d out"), state.plugin_inputs, state.plugin_outputs);
+}
+
+// 先読み (lookahead) などでプラグインが出力を遅らせるサンプル数
+void QueryPluginLatency(HostState &state)
+{
+    char response[64];
+    int latency = 0;
+    if (!SendCommandToHost(state, "get_latency\n", response, sizeof(response)) || sscanf_s(response, "OK %d", &latency) != 1)
+    {
+        state.latency_samples = 0;
+        return;
+    }
+    state.latency_samples = std::clamp(latency, 0, MAX_REPORTED_LATENCY);
+    DbgPrint(_T("Plugin latency: %d samples"), state.latency_samples.load());
+}
+
+// 入力が途切れてから出力が 16 ビットで 0 になるまでのサンプル数。負の値は余韻が終わらないことを表す
+void QueryPluginTail(HostState &state)
+{
+    char response[64];
+    int tail = -1;
+    state.tail_stale = false;
+    if (!SendCommandToHost(state, "get_tail\n", response, sizeof(response)) || sscanf_s(response, "OK %d", &tail) != 1)
+    {
+        state.tail_samples = -1;
+        return;
+    }
+    state.tail_samples = std::min(tail, MAX_REPORTED_TAIL);
+    DbgPrint(_T("Plugin tail: %d samples"), state.tail_samples);
+}
+
+std::shared_ptr<HostProcess> StartHostProcess(const TCHAR *host_path)
+{
+    auto process = std::make_shared<HostProcess>();
+    _tcscpy_s(process->host_path, MAX_PATH, host_path);
+    DbgPrint(_T("Attempting to launch host from: %s"), host_path);
+    TCHAR cmd_line[MAX_PATH * 4];
+    _stprintf_s(cmd_line, _T("\"%s\" -uid %llu -pipe \"%s\" -shm \"%s\" -event_ready \"%s\" -event_done \"%s\""), host_path, process->unique_id, PIPE_NAME_BASE, SHARED_MEM_NAME_BASE, EVENT_CLIENT_READY_NAME_BASE, EVENT_HOST_DONE_NAME_BASE);
+    DbgPrint(_T("Launching host with command line: %s"), cmd_line);
+
+    STARTUPINFO si = {sizeof(si)};
+    if (!CreateProcess(NULL, cmd_line, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &process->pi))
+    {
+        DbgPrint(_T("CreateProcess failed: %lu."), GetLastError());
+        process->pi = {};
+        return nullptr;
+    }
+    if (!ConnectIPC(*process))
+    {
+        DbgPrint(_T("ConnectIPC failed."));
+        return nullptr;
+    }
+    QueryHostCapabilities(*process);
+    if (process->host_caps & host_caps::binary)
+    {
+        char response[64];
+        if (SendCommandToProcess(*process, "set_protocol binary\n", response, sizeof(response)) && strncmp(response, "OK", 2) == 0)
+            process->binary_protocol = true;
+        DbgPrint(_T("Pipe protocol: %hs"), process->binary_protocol ? "binary" : "text");
+    }
+    return process;
+}
+
+// =================================================================
+// ホストプロセスのプール
+// =================================================================
+// audio_plugin_link.ini の [Prewarm] に指定された数だけ、接続済みで待機中のホストを保持する。
+// オブジェクトは待機中のホストを取得して load_plugin だけを送り、空いた分はバックグラウンドで補充される。
+class HostProcessPool
+{
+public:
+    void Start(std::unordered_map<std::basic_string<TCHAR>, int> pool_targets)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (worker.joinable())
+            return;
+        targets = std::move(pool_targets);
+        stopping = false;
+        worker = std::thread([this]
+                             { Run(); });
+    }
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.clear();
+    }
+    std::shared_ptr<HostProcess> Take(const TCHAR *host_path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = idle.find(host_path);
+        while (it != idle.end() && !it->second.empty())
+        {
+            auto process = std::move(it->second.front());
+            it->second.pop_front();
+            if (process->IsAlive())
+            {
+                DbgPrint(_T("Claimed prewarmed host process %lu."), process->pi.dwProcessId);
+                cv.notify_all();
+                return process;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    void Run()
+    {
+        trace::SetThreadName("host_pool");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping)
+        {
+            std::basic_string<TCHAR> host_path;
+            for (auto &[path, target] : targets)
+            {
+                auto &queue = idle[path];
+                queue.erase(std::remove_if(queue.begin(), queue.end(), [](const auto &p)
+                                           { return !p->IsAlive(); }),
+                            queue.end());
+                if (static_cast<int>(queue.size()) < target)
+                {
+                    host_path = path;
+                    break;
+                }
+            }
+            if (host_path.empty())
+            {
+                cv.wait_for(lock, std::chrono::seconds(5));
+                continue;
+            }
+            lock.unlock();
+            auto process = StartHostProcess(host_path.c_str());
+            lock.lock();
+            if (!process)
+            {
+                DbgPrint(_T("Prewarming %s failed. Retrying later."), host_path.c_str());
+                cv.wait_for(lock, std::chrono::seconds(5));
+                continue;
+            }
+            idle[host_path].push_back(std::move(process));
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<std::basic_string<TCHAR>, int> targets;
+    std::unordered_map<std::basic_string<TCHAR>, std::deque<std::shared_ptr<HostProcess>>> idle;
+    std::thread worker;
+    bool stopping = false;
+};
+HostProcessPool g_host_pool;
+
+void StartHostPool()
+{
+    TCHAR audio_exe_dir[MAX_PATH];
+    TCHAR ini_path[MAX_PATH];
+    if (!GetAudioExePaths(audio_exe_dir, ini_path) || GetFileAttributes(ini_path) == INVALID_FILE_ATTRIBUTES)
+        return;
+    TCHAR keys[2048];
+    if (GetPrivateProfileString(_T("Prewarm"), NULL, _T(""), keys, sizeof(keys) / sizeof(TCHAR), ini_path) == 0)
+        return;
+    std::unordered_map<std::basic_string<TCHAR>, int> targets;
+    for (const TCHAR *key = keys; *key; key += _tcslen(key) + 1)
+    {
+        int count = std::min(static_cast<int>(GetPrivateProfileInt(_T("Prewarm"), key, 0, ini_path)), MAX_PREWARM_PER_HOST);
+        TCHAR host_exe_name[MAX_PATH];
+        GetPrivateProfileString(_T("Mappings"), key, _T(""), host_exe_name, MAX_PATH, ini_path);
+        if (count <= 0 || _tcslen(host_exe_name) == 0)
+            continue;
+        TCHAR host_path[MAX_PATH];
+        _stprintf_s(host_path, _T("%s\\%s"), audio_exe_dir, host_exe_name);
+        int &target = targets[host_path];
+        target = std::max(target, count);
+        DbgPrint(_T("Prewarming %d host(s) for %s: %s"), target, key, host_path);
+    }
+    if (!targets.empty())
+        g_host_pool.Start(std::move(targets));
+}
+
+void StopHostPool()
+{
+    g_host_pool.Stop();
+}
+
+void LoadSettings()
+{
+    int cache_mb = DEFAULT_AUDIO_CACHE_MB;
+    int preroll_ms = DEFAULT_PREROLL_MS;
+    DWORD export_timeout_ms = DEFAULT_EXPORT_TIMEOUT_MS;
+    int frame_budget_percent = DEFAULT_FRAME_BUDGET_PERCENT;
+    DWORD export_frame_budget_ms = 0;
+    int max_live_hosts = 0;
+    int host_memory_mb = 0;
+    int retention_days = DEFAULT_STATE_STORE_RETENTION_DAYS;
+    TCHAR audio_exe_dir[MAX_PATH] = {0};
+    TCHAR ini_path[MAX_PATH] = {0};
+    if (GetAudioExePaths(audio_exe_dir, ini_path))
+    {
+        TCHAR store_dir[MAX_PATH];
+        _stprintf_s(store_dir, _T("%s\\%s"), audio_exe_dir, _T("state_store"));
+        state_store::SetDirectory(store_dir);
+    }
+    if (GetFileAttributes(ini_path) != INVALID_FILE_ATTRIBUTES)
+    {
+        cache_mb = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("AudioCacheMB"), DEFAULT_AUDIO_CACHE_MB, ini_path));
+        preroll_ms = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("PrerollMs"), DEFAULT_PREROLL_MS, ini_path));
+        export_timeout_ms = std::max<DWORD>(GetPrivateProfileInt(_T("Settings"), _T("ExportTimeoutMs"), DEFAULT_EXPORT_TIMEOUT_MS, ini_path), BLOCK_TIMEOUT_MS);
+        frame_budget_percent = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("FrameBudgetPercent"), DEFAULT_FRAME_BUDGET_PERCENT, ini_path));
+        export_frame_budget_ms = GetPrivateProfileInt(_T("Settings"), _T("ExportFrameBudgetMs"), 0, ini_path);
+        max_live_hosts = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("MaxLiveHosts"), 0, ini_path));
+        host_memory_mb = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("HostMemoryMB"), 0, ini_path));
+        retention_days = static_cast<int>(GetPrivateProfileInt(_T("Settings"), _T("StateStoreRetentionDays"), DEFAULT_STATE_STORE_RETENTION_DAYS, ini_path));
+        TCHAR trace_file[MAX_PATH] = {0};
+        GetPrivateProfileString(_T("Settings"), _T("TraceFile"), _T(""), trace_file, MAX_PATH, ini_path);
+        if (trace_file[0] != _T('\0'))
+        {
+            // ファイル名だけなら audio_exe フォルダに置く
+            if (_tcschr(trace_file, _T(':')) || trace_file[0] == _T('\\'))
+                _tcscpy_s(g_trace_path, trace_file);
+            else
+                _stprintf_s(g_trace_path, _T("%s\\%s"), audio_exe_dir, trace_file);
+            trace::Enable();
+            DbgPrint(_T("Tracing enabled. Output: %s"), g_trace_path);
+        }
+    }
+    g_export_timeout_ms = export_timeout_ms;
+    g_frame_budget_percent = std::clamp(frame_budget_percent, 0, MAX_FRAME_BUDGET_PERCENT);
+    g_export_frame_budget_ms = export_frame_budget_ms;
+    g_max_live_hosts = std::max(max_live_hosts, 0);
+    g_host_memory_budget = static_cast<uint64_t>(std::max(host_memory_mb, 0)) * 1024 * 1024;
+    g_state_store_retention_days = std::max(retention_days, 0);
+    g_audio_cache.SetBudget(static_cast<size_t>(std::max(cache_mb, 0)) * 1024 * 1024);
+    g_preroll_ms = std::clamp(preroll_ms, 0, MAX_PREROLL_MS);
+    DbgPrint(_T("Audio cache budget: %d MB, preroll: %d ms"), cache_mb, g_preroll_ms.load());
+    DbgPrint(_T("Frame budget: %d%% of a frame (preview), %lu ms (export, 0 = unlimited)"), g_frame_budget_percent.load(), g_export_frame_budget_ms.load());
+    DbgPrint(_T("Live hosts: max %d, memory budget %d MB (0 = unlimited)"), g_max_live_hosts.load(), std::max(host_memory_mb, 0));
+}
+
+std::shared_ptr<HostProcess> ObtainHostProcess(const TCHAR *host_path)
+{
+    if (auto process = g_host_pool.Take(host_path))
+        return process;
+    return StartHostProcess(host_path);
+}
+
+// 同じホストプログラムを使うオブジェクト間で1つのプロセスを共有する。
+// ホストがマルチインスタンスに対応していない場合は専用プロセスとして返す
+std::shared_ptr<HostProcess> AcquireSharedHostProcess(const TCHAR *host_path)
+{
+    std::lock_guard<std::mutex> lock(g_processes_mutex);
+    for (auto it = g_shared_processes.begin(); it != g_shared_processes.end();)
+    {
+        it = it->second.expired() ? g_shared_processes.erase(it) : std::next(it);
+    }
+    auto it = g_shared_processes.find(host_path);
+    if (it != g_shared_processes.end())
+    {
+        auto process = it->second.lock();
+        if (process && process->IsAlive())
+            return process;
+    }
+    auto process = ObtainHostProcess(host_path);
+    if (!process)
+        return nullptr;
+    constexpr uint32_t required = host_caps::multi_instance | host_caps::ring;
+    if ((process->host_caps & required) == required && CreateArena(*process))
+    {
+        process->shared = true;
+        g_shared_processes[host_path] = process;
+    }
+    else
+    {
+        DbgPrint(_T("Host does not support multiple instances. Using a dedicated process."));
+    }
+    return process;
+}
+
+// ランチャースレッドはユーザーの操作を待たない (他のオブジェクトの起動が止まる)。
+// エラーは HostState に残し、LaunchHost が WM_APP_LAUNCH_FAILED でメインスレッドに表示させる
+bool ReportLaunchError(HostState &state, const TCHAR *title, const TCHAR *text)
+{
+    DbgPrint(_T("Launch error: %s"), text);
+    state.launch_error_title = title;
+    state.launch_error = text;
+    return false;
+}
+
+bool LaunchHostProcess(const LaunchRequest &request, HostState &state)
+{
+    TRACE_SPAN("LaunchHostProcess");
     TCHAR msg[MAX_PATH + 256];
     TCHAR host_path[MAX_PATH];
     bool is_standalone_exe = false;
+    bool use_shared_process = false;
 
-    const TCHAR *extension = _tcsrchr(exdata->plugin_path, _T('.'));
+    const TCHAR *extension = _tcsrchr(request.plugin_path, _T('.'));
     if (!extension)
     {
-        _stprintf_s(msg, _T("プラグインパスに拡張子が含まれていません。\nパス: %s"), exdata->plugin_path);
-        MessageBox(efp->exedit_fp->hwnd, msg, _T("設定エラー"), MB_OK | MB_ICONERROR);
-        return false;
+        _stprintf_s(msg, _T("プラグインパスに拡張子が含まれていません。\nパス: %s"), request.plugin_path);
+        return ReportLaunchError(state, _T("設定エラー"), msg);
     }
 
     if (_tcsicmp(extension, _T(".exe")) == 0)
     {
+        if (!request.chain_paths.empty())
+            return ReportLaunchError(state, _T("設定エラー"), _T("スタンドアロンEXEホストにはプラグインを追加できません。\nプラグインを選択し直してください。"));
         is_standalone_exe = true;
-        _tcscpy_s(host_path, MAX_PATH, exdata->plugin_path);
+        _tcscpy_s(host_path, MAX_PATH, request.plugin_path);
         DbgPrint(_T("Standalone executable host selected: %s"), host_path);
     }
     else
     {
-        TCHAR aviutl_dir[MAX_PATH];
-        GetModuleFileName(NULL, aviutl_dir, MAX_PATH);
-        TCHAR *last_slash = _tcsrchr(aviutl_dir, _T('\\'));
-        if (!last_slash)
-            return false;
-        *(last_slash + 1) = _T('\0');
         TCHAR audio_exe_dir[MAX_PATH];
-        _stprintf_s(audio_exe_dir, _T("%s%s"), aviutl_dir, _T("audio_exe"));
         TCHAR ini_path[MAX_PATH];
-        _stprintf_s(ini_path, _T("%s\\%s"), audio_exe_dir, _T("audio_plugin_link.ini"));
+        if (!GetAudioExePaths(audio_exe_dir, ini_path))
+            return false;
         if (GetFileAttributes(ini_path) == INVALID_FILE_ATTRIBUTES)
         {
             _stprintf_s(msg, _T("設定ファイルが見つかりません。\nパス: %s"), ini_path);
-            MessageBox(efp->exedit_fp->hwnd, msg, _T("設定エラー"), MB_OK | MB_ICONERROR);
-            return false;
+            return ReportLaunchError(state, _T("設定エラー"), msg);
         }
         TCHAR host_exe_name[MAX_PATH];
         GetPrivateProfileString(_T("Mappings"), extension, _T(""), host_exe_name, MAX_PATH, ini_path);
         if (_tcslen(host_exe_name) == 0)
         {
             _stprintf_s(msg, _T("設定ファイルに拡張子 '%s' の定義がありません。\n\n%s の [Mappings] セクションに\n%s=ホスト名.exe\nのように追記してください。"), extension, ini_path, extension);
-            MessageBox(efp->exedit_fp->hwnd, msg, _T("設定エラー"), MB_OK | MB_ICONERROR);
-            return false;
+            return ReportLaunchError(state, _T("設定エラー"), msg);
+        }
+        // チェーンは1つのホストの中で処理するため、すべて同じホストに関連付けられている必要がある
+        for (const auto &chain_path : request.chain_paths)
+        {
+            const TCHAR *chain_extension = _tcsrchr(chain_path.c_str(), _T('.'));
+            TCHAR chain_exe_name[MAX_PATH] = {0};
+            if (chain_extension)
+                GetPrivateProfileString(_T("Mappings"), chain_extension, _T(""), chain_exe_name, MAX_PATH, ini_path);
+            if (_tcsicmp(chain_exe_name, host_exe_name) != 0)
+            {
+                _stprintf_s(msg, _T("追加したプラグインは最初のプラグインと同じホスト (%s) で処理できません。\nパス: %s"), host_exe_name, chain_path.c_str());
+                return ReportLaunchError(state, _T("設定エラー"), msg);
+            }
         }
         _stprintf_s(host_path, _T("%s\\%s"), audio_exe_dir, host_exe_name);
+        use_shared_process = GetPrivateProfileInt(_T("Settings"), _T("SharedHostProcess"), 0, ini_path) != 0;
     }
     if (GetFileAttributes(host_path) == INVALID_FILE_ATTRIBUTES)
     {
         _stprintf_s(msg, _T("指定されたホストプログラムが見つかりません。\nパス: %s"), host_path);
-        MessageBox(efp->exedit_fp->hwnd, msg, _T("起動エラー"), MB_OK | MB_ICONERROR);
-        return false;
+        return ReportLaunchError(state, _T("起動エラー"), msg);
     }
 
-    DbgPrint(_T("Attempting to launch host from: %s"), host_path);
-    TCHAR cmd_line[MAX_PATH * 4];
-    _stprintf_s(cmd_line, _T("\"%s\" -uid %llu -pipe \"%s\" -shm \"%s\" -event_ready \"%s\" -event_done \"%s\""), host_path, state.unique_id, PIPE_NAME_BASE, SHARED_MEM_NAME_BASE, EVENT_CLIENT_READY_NAME_BASE, EVENT_HOST_DONE_NAME_BASE);
-    DbgPrint(_T("Launching host with command line: %s"), cmd_line);
-
-    STARTUPINFO si = {sizeof(si)};
-    if (!CreateProcess(NULL, cmd_line, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &state.pi))
-    {
-        DbgPrint(_T("CreateProcess failed: %lu."), GetLastError());
+    state.process = use_shared_process ? AcquireSharedHostProcess(host_path) : ObtainHostProcess(host_path);
+    if (!state.process)
         return false;
-    }
-
     state.host_running = true;
-    if (!ConnectIPC(state))
+    HostProcess &process = *state.process;
+    if (process.shared)
     {
-        DbgPrint(_T("ConnectIPC failed."));
-        CloseHandle(state.pi.hProcess);
-        CloseHandle(state.pi.hThread);
-        state.pi = {};
-        return false;
+        char response[64];
+        int instance_id = -1;
+        if (!SendCommandToProcess(process, "create_instance\n", response, sizeof(response)) || sscanf_s(response, "OK %d", &instance_id) != 1)
+        {
+            DbgPrint(_T("create_instance failed. Response: %hs"), response);
+            return false;
+        }
+        state.instance_id = instance_id;
+        DbgPrint(_T("Created instance %d in shared host process %lu."), instance_id, process.pi.dwProcessId);
+    }
+    else
+    {
+        state.client_ready = &process.client_ready;
+        state.host_done = &process.host_done;
+    }
+    if (!request.chain_paths.empty() && !(process.host_caps & host_caps::chain))
+    {
+        _stprintf_s(msg, _T("ホストプログラムがプラグインの直列処理に対応していません。\nパス: %s"), host_path);
+        return ReportLaunchError(state, _T("起動エラー"), msg);
     }
+    state.block_size = NegotiateBlockSize(process, request.audio_n);
+    DbgPrint(_T("Negotiated block size: %d (frame: %d samples)"), state.block_size, request.audio_n);
 
     char response[256];
     if (is_standalone_exe)
     {
-        std::vector<char> cmd_buffer;
-        if (strlen(exdata->state_b64) > 0)
+        char command[256];
+        bool sent;
+        if (!request.state_b64.empty())
         {
-            size_t state_len = strlen(exdata->state_b64);
-            cmd_buffer.resize(state_len + 256);
-            sprintf_s(cmd_buffer.data(), cmd_buffer.size(), "init_with_state %f %d %s\n", (double)efpip->audio_rate, MAX_BLOCK_SIZE, exdata->state_b64);
+            sprintf_s(command, "init_with_state %f %d", (double)request.audio_rate, state.block_size);
+            sent = SendStateCommandToHost(state, command, request.state_b64, response, sizeof(response));
         }
         else
         {
-            cmd_buffer.resize(256);
-            sprintf_s(cmd_buffer.data(), cmd_buffer.size(), "init %f %d\n", (double)efpip->audio_rate, MAX_BLOCK_SIZE);
+            sprintf_s(command, "init %f %d\n", (double)request.audio_rate, state.block_size);
+            sent = SendCommandToHost(state, command, response, sizeof(response));
         }
-        if (!SendCommandToHost(state, cmd_buffer.data(), response, sizeof(response)) || strncmp(response, "OK", 2) != 0)
+        if (!sent || strncmp(response, "OK", 2) != 0)
         {
             DbgPrint(_T("Failed to initialize standalone host. Response: %hs"), response);
             return false;
         }
     }
+    else if (!request.chain_paths.empty())
+    {
+        // 全段をホストの中で float のまま処理させ、ブロックの往復は1回で済ませる
+        char rate_and_block[64];
+        sprintf_s(rate_and_block, " %f %d", (double)request.audio_rate, state.block_size);
+        std::string command = request.state_b64.empty() ? "load_chain" : "load_chain_and_set_state";
+        command.append(rate_and_block);
+        char path_mb[MAX_PATH];
+        ToUtf8(request.plugin_path, path_mb, MAX_PATH);
+        command.append(" \"").append(path_mb).append("\"");
+        for (const auto &chain_path : request.chain_paths)
+        {
+            ToUtf8(chain_path.c_str(), path_mb, MAX_PATH);
+            command.append(" \"").append(path_mb).append("\"");
+        }
+        bool sent;
+        if (!request.state_b64.empty())
+        {
+            sent = SendStateCommandToHost(state, command.c_str(), request.state_b64, response, sizeof(response));
+        }
+        else
+        {
+            command += "\n";
+            sent = SendCommandToHost(state, command.c_str(), response, sizeof(response));
+        }
+        if (!sent || strncmp(response, "OK", 2) != 0)
+        {
+            DbgPrint(_T("Failed to configure plugin chain. Response: %hs"), response);
+            return false;
+        }
+        DbgPrint(_T("Loaded a chain of %zu plugins."), request.chain_paths.size() + 1);
+    }
     else
     {
         char plugin_path_mb[MAX_PATH];
-#ifdef UNICODE
-        WideCharToMultiByte(CP_UTF8, 0, exdata->plugin_path, -1, plugin_path_mb, MAX_PATH, NULL, NULL);
-#else
-        strcpy_s(plugin_path_mb, MAX_PATH, exdata->plugin_path);
-#endif
-        std::vector<char> cmd_buffer;
-        if (strlen(exdata->state_b64) > 0)
+        ToUtf8(request.plugin_path, plugin_path_mb, MAX_PATH);
+        char command[MAX_PATH + 128];
+        bool sent;
+        if (!request.state_b64.empty())
         {
-            size_t state_len = strlen(exdata->state_b64);
-            cmd_buffer.resize(state_len + 1024);
-            sprintf_s(cmd_buffer.data(), cmd_buffer.size(), "load_and_set_state \"%s\" %f %d %s\n", plugin_path_mb, (double)efpip->audio_rate, MAX_BLOCK_SIZE, exdata->state_b64);
+            sprintf_s(command, "load_and_set_state \"%s\" %f %d", plugin_path_mb, (double)request.audio_rate, state.block_size);
+            sent = SendStateCommandToHost(state, command, request.state_b64, response, sizeof(response));
         }
         else
         {
-            cmd_buffer.resize(1024);
-            sprintf_s(cmd_buffer.data(), cmd_buffer.size(), "load_plugin \"%s\" %f %d\n", plugin_path_mb, (double)efpip->audio_rate, MAX_BLOCK_SIZE);
+            sprintf_s(command, "load_plugin \"%s\" %f %d\n", plugin_path_mb, (double)request.audio_rate, state.block_size);
+            sent = SendCommandToHost(state, command, response, sizeof(response));
         }
-        if (!SendCommandToHost(state, cmd_buffer.data(), response, sizeof(response)) || strncmp(response, "OK", 2) != 0)
+        if (!sent || strncmp(response, "OK", 2) != 0)
         {
             DbgPrint(_T("Failed to configure plugin. Response: %hs"), response);
             return false;
         }
     }
 
+    if (process.host_caps & host_caps::ring)
+    {
+        QueryPluginIoConfig(state);
+        state.channel_count = std::clamp(request.audio_ch, 1, static_cast<int>(RING_MAX_CHANNELS));
+        if (process.shared)
+        {
+            // 共有プロセスの単一バッファは全インスタンスで共用されるため、リングが必須
+            if (!AttachInstanceRing(state))
+                return false;
+        }
+        else if (!AttachRing(state))
+        {
+            DbgPrint(_T("Falling back to single-slot shared memory."));
+        }
+    }
+    state.sample_rate = request.audio_rate;
+    if (process.host_caps & host_caps::latency)
+        QueryPluginLatency(state);
+    if (process.host_caps & host_caps::tail)
+        QueryPluginTail(state);
+    // 読み込んだ状態は exdata と同じなので、起動時点の通し番号を同期済みとする
+    state.notify_hwnd = request.hwnd;
+    ReadStateSerial(state, state.synced_state_serial);
     DbgPrint(_T("Host launched and initialized successfully."));
     return true;
 }
+// =================================================================
+// 非同期起動
+// =================================================================
+// 起動要求から ready までの時間 (= バイパスしていた時間) の分布
+class LaunchLatencyHistogram
+{
+public:
+    static constexpr ULONGLONG bounds_ms[] = {100, 250, 500, 1000, 2500, 5000, 10000};
+
+    void Record(ULONGLONG elapsed_ms)
+    {
+        size_t bucket = 0;
+        while (bucket < std::size(bounds_ms) && elapsed_ms >= bounds_ms[bucket])
+            ++bucket;
+        counts[bucket]++;
+    }
+    void Dump() const
+    {
+        TCHAR line[256] = {0};
+        for (size_t i = 0; i <= std::size(bounds_ms); ++i)
+        {
+            TCHAR entry[32];
+            if (i < std::size(bounds_ms))
+                _stprintf_s(entry, _T(" <%llums:%u"), bounds_ms[i], counts[i].load());
+            else
+                _stprintf_s(entry, _T(" >=%llums:%u"), bounds_ms[i - 1], counts[i].load());
+            _tcscat_s(line, entry);
+        }
+        DbgPrint(_T("Launch latency histogram:%s"), line);
+    }
+
+private:
+    std::atomic<uint32_t> counts[std::size(bounds_ms) + 1] = {};
+};
+LaunchLatencyHistogram g_launch_latency;
+
+// 起動要求は1本のスレッドで順に処理する。ConnectIPC の待機などで func_proc や他のオブジェクトを止めないため
+void LaunchHost(LaunchRequest &request)
+{
+    HostState &state = *request.state;
+    // 起動待ちの間にオブジェクトが削除された
+    if (request.state.use_count() == 1)
+        return;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!LaunchHostProcess(request, state))
+    {
+        DbgPrint(_T("Host launch failed for %s. Bypassing."), request.plugin_path);
+        state.CleanupForRestart();
+        state.launch_status.store(LaunchStatus::failed, std::memory_order_release);
+        if (!state.launch_error.empty())
+            PostMessage(request.hwnd, WM_APP_LAUNCH_FAILED, request.object_id, 0);
+        return;
+    }
+    ULONGLONG elapsed = GetTickCount64() - request.requested_at;
+    g_launch_latency.Record(elapsed);
+    stats_page::Set(state.stats->launchMs, elapsed);
+    if (state.evicted.exchange(false))
+    {
+        stats_page::Add(state.stats->restores, 1);
+        stats_page::Add(state.stats->restoreMs, elapsed);
+    }
+    DbgPrint(_T("Host ready after %llu ms in bypass."), elapsed);
+    g_launch_latency.Dump();
+    state.launch_status.store(LaunchStatus::ready, std::memory_order_release);
+    if (state.latency_samples > 0)
+        PostMessage(request.hwnd, WM_APP_UPDATE_GUI, 0, 0);
+}
+host_registry::Launcher<LaunchRequest> g_host_launcher("host_launcher", LaunchHost);
+
+void RequestHostLaunch(ExEdit::Filter *efp, ExEdit::FilterProcInfo *efpip, const std::shared_ptr<HostState> &state)
+{
+    auto *exdata = reinterpret_cast<Exdata *>(efp->exdata_ptr);
+    LaunchRequest request;
+    request.state = state;
+    request.object_id = static_cast<uint32_t>(efp->processing);
+    request.hwnd = efp->exedit_fp->hwnd;
+    _tcscpy_s(request.plugin_path, MAX_PATH, exdata->plugin_path);
+    for (int i = 0; i < ChainLength(exdata); ++i)
+        request.chain_paths.emplace_back(ChainPath(exdata, i));
+    ResolveSavedState(exdata->state_b64, request.state_b64);
+    request.audio_rate = efpip->audio_rate;
+    request.audio_n = efpip->audio_n;
+    request.audio_ch = efpip->audio_ch;
+    request.requested_at = GetTickCount64();
+    DbgPrint(_T("Queued host launch for %s."), request.plugin_path);
+    g_host_launcher.Submit(std::move(request));
+}
+
+void StopHostLauncher()
+{
+    g_host_launcher.Stop();
+}
+
+// =================================================================
+// 状態の同期
+// =================================================================
+// host_caps::state_serial に対応したホストの通し番号を定期的に調べ、変わっていれば
+// get_state で状態を取得しておく。GUI を閉じ忘れても次の func_proc か設定ダイアログで exdata に反映される。
+// パラメーターの変更で古くなった余韻の長さ (host_caps::tail) もここで問い合わせ直す
+class StateSyncer
+{
+public:
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (worker.joinable())
+            return;
+        stopping = false;
+        worker = std::thread([this]
+                             { Run(); });
+    }
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    void Run()
+    {
+        trace::SetThreadName("state_sync");
+        // 起動のたびに1回、期限を過ぎた保存領域のファイルを消す
+        if (int deleted = state_store::Sweep(g_state_store_retention_days); deleted > 0)
+            DbgPrint(_T("Removed %d expired files from the state store."), deleted);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!cv.wait_for(lock, std::chrono::milliseconds(STATE_SYNC_INTERVAL_MS), [this]
+                            { return stopping; }))
+        {
+            lock.unlock();
+            Poll();
+            lock.lock();
+        }
+    }
+    static void Poll()
+    {
+        const auto states = g_host_states.Snapshot();
+        for (auto &[object_id, state] : states)
+        {
+            if (IsHostReady(*state))
+            {
+                Sync(object_id, *state);
+                RefreshTail(object_id, *state);
+            }
+        }
+    }
+    static void Sync(uint32_t object_id, HostState &state)
+    {
+        TRACE_SPAN("state_sync", object_id);
+        std::shared_ptr<HostProcess> process;
+        int32_t instance_id;
+        uint32_t serial;
+        {
+            // func_proc の処理中なら次の周期に回す
+            std::unique_lock<std::mutex> lock(state.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || !ReadStateSerial(state, serial) || serial == state.synced_state_serial)
+                return;
+            process = state.process;
+            instance_id = state.instance_id;
+        }
+        // 取得中も func_proc を止めないよう、state.mutex を保持せずパイプのロックだけで通信する
+        std::string state_b64;
+        std::string reference;
+        if (!RequestStateFromProcess(*process, instance_id, state_b64))
+        {
+            DbgPrint(_T("Background get_state failed for object %u."), object_id);
+            return;
+        }
+        if (!FormatStateReference(state_b64, STATE_INLINE_MAX_LEN, reference))
+        {
+            DbgPrint(_T("State for object %u is too large to store inline (%zu bytes) and the state store is unavailable."), object_id, state_b64.size());
+            return;
+        }
+        HWND hwnd;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            // 取得中にホストが再起動された
+            if (state.process != process || state.instance_id != instance_id)
+            {
+                DiscardStateReference(reference);
+                return;
+            }
+            state.synced_state_serial = serial;
+            SetPendingState(state, std::move(reference));
+            MarkTailStale(state);
+            hwnd = state.notify_hwnd;
+        }
+        DbgPrint(_T("Synced state for object %u (serial %u, %zu bytes)."), object_id, serial, state_b64.size());
+        if (hwnd)
+            PostMessage(hwnd, WM_APP_STATE_SYNCED, object_id, 0);
+    }
+
+    static void RefreshTail(uint32_t object_id, HostState &state)
+    {
+        std::shared_ptr<HostProcess> process;
+        int32_t instance_id;
+        uint32_t epoch;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || !state.tail_stale || !state.host_running || !(state.process->host_caps & host_caps::tail))
+                return;
+            process = state.process;
+            instance_id = state.instance_id;
+            epoch = state.tail_epoch;
+        }
+        TRACE_SPAN("tail_refresh", object_id);
+        char response[64];
+        int tail = -1;
+        if (!ExchangeCommand(*process, instance_id, "get_tail\n", response, sizeof(response)) || sscanf_s(response, "OK %d", &tail) != 1)
+            tail = -1;
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.process != process || state.instance_id != instance_id || state.tail_epoch != epoch)
+            return;
+        state.tail_samples = std::min(tail, MAX_REPORTED_TAIL);
+        state.tail_stale = false;
+        DbgPrint(_T("Plugin tail for object %u: %d samples"), object_id, state.tail_samples);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+    bool stopping = false;
+};
+StateSyncer g_state_syncer;
+
+void StartStateSync()
+{
+    g_state_syncer.Start();
+}
+
+void StopStateSync()
+{
+    g_state_syncer.Stop();
+}
+
+// =================================================================
+// アイドル状態のホストの退避
+// =================================================================
+// 稼働中のホストの数が g_max_live_hosts を、ホストプロセスのメモリの合計が g_host_memory_budget を超えたら、
+// 最も長く処理されていないオブジェクトから状態を取得してホストを終了させる。状態は exdata に書き込まれ、
+// 次にそのオブジェクトが処理されたときに通常の起動と同じ経路で復元される。
+// 直近 MIN_HOST_IDLE_MS 以内に処理されたオブジェクトと GUI を表示中のオブジェクトは対象にしない
+class HostEvictor
+{
+public:
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (worker.joinable())
+            return;
+        stopping = false;
+        worker = std::thread([this]
+                             { Run(); });
+    }
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    struct LiveHost
+    {
+        uint32_t object_id;
+        std::shared_ptr<HostState> state;
+        uint64_t last_used_us;
+        HostProcess *process;
+    };
+
+    void Run()
+    {
+        trace::SetThreadName("host_evictor");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!cv.wait_for(lock, std::chrono::milliseconds(HOST_EVICT_INTERVAL_MS), [this]
+                            { return stopping; }))
+        {
+            lock.unlock();
+            Poll();
+            lock.lock();
+        }
+    }
+    // ホストプロセスのコミット済みのプライベートメモリ
+    static uint64_t ProcessMemoryBytes(HostProcess &process)
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        counters.cb = sizeof(counters);
+        if (!process.pi.hProcess || !GetProcessMemoryInfo(process.pi.hProcess, &counters, sizeof(counters)))
+            return 0;
+        return counters.PagefileUsage;
+    }
+    static void Poll()
+    {
+        const int max_live = g_max_live_hosts;
+        const uint64_t memory_budget = g_host_memory_budget;
+        if (max_live == 0 && memory_budget == 0)
+            return;
+        const auto states = g_host_states.Snapshot();
+        std::vector<LiveHost> live;
+        std::vector<std::shared_ptr<HostProcess>> processes;
+        for (auto &[object_id, state] : states)
+        {
+            if (!IsHostReady(*state))
+                continue;
+            std::shared_ptr<HostProcess> process;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                process = state->process;
+            }
+            if (!process)
+                continue;
+            live.push_back({object_id, state, state->last_used_us.load(), process.get()});
+            processes.push_back(std::move(process));
+        }
+        // プロセスごとのメモリと、そのプロセスを使っているオブジェクトの数 (うち最近使われたもの)
+        struct ProcessUsage
+        {
+            uint64_t bytes = 0;
+            int instances = 0;
+            int busy = 0;
+        };
+        const uint64_t now = stats_page::NowUs();
+        auto is_idle = [now](const LiveHost &host)
+        { return now - std::min(now, host.last_used_us) >= static_cast<uint64_t>(MIN_HOST_IDLE_MS) * 1000; };
+        uint64_t total_bytes = 0;
+        std::unordered_map<HostProcess *, ProcessUsage> usage;
+        for (const auto &host : live)
+        {
+            auto &entry = usage[host.process];
+            entry.instances++;
+            entry.busy += is_idle(host) ? 0 : 1;
+        }
+        for (auto &[process, entry] : usage)
+        {
+            entry.bytes = ProcessMemoryBytes(*process);
+            total_bytes += entry.bytes;
+        }
+
+        std::sort(live.begin(), live.end(), [](const LiveHost &a, const LiveHost &b)
+                  { return a.last_used_us < b.last_used_us; });
+        size_t live_count = live.size();
+        for (auto &host : live)
+        {
+            const bool over_count = max_live > 0 && live_count > static_cast<size_t>(max_live);
+            const bool over_memory = memory_budget > 0 && total_bytes > memory_budget;
+            if (!over_count && !over_memory)
+                break;
+            // 古い順に並んでいるため、以降はすべて最近使われている
+            if (!is_idle(host))
+                break;
+            // 共有プロセスは最後のインスタンスを退避するまで終了せずメモリも減らない。
+            // メモリのためだけなら、最近使われたインスタンスが残るプロセスには手を付けない
+            auto &entry = usage[host.process];
+            if (!over_count && entry.busy > 0)
+                continue;
+            if (!Evict(host.object_id, *host.state))
+            {
+                entry.busy++;
+                continue;
+            }
+            --live_count;
+            if (--entry.instances == 0)
+                total_bytes -= std::min(total_bytes, entry.bytes);
+        }
+    }
+    static bool Evict(uint32_t object_id, HostState &state)
+    {
+        TRACE_SPAN("host_evict", object_id);
+        const uint64_t started = stats_page::NowUs();
+        std::shared_ptr<HostProcess> process;
+        int32_t instance_id;
+        uint64_t last_used_us;
+        bool has_serial;
+        uint32_t serial = 0;
+        bool needs_state;
+        {
+            // func_proc の処理中なら次の周期に回す
+            std::unique_lock<std::mutex> lock(state.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || !IsHostReady(state) || state.gui_visible || !IsHostAlive(state))
+                return false;
+            // 通し番号が変わっていなければ exdata (か pending_state) が最新の状態を持っている
+            has_serial = ReadStateSerial(state, serial);
+            needs_state = !has_serial || serial != state.synced_state_serial;
+            process = state.process;
+            instance_id = state.instance_id;
+            last_used_us = state.last_used_us;
+        }
+        // 状態の取得は func_proc を止めないよう、state.mutex を保持せずパイプのロックだけで行う
+        std::string reference;
+        if (needs_state)
+        {
+            std::string state_b64;
+            // 状態を残せなければ復元できないため退避しない
+            if (!RequestStateFromProcess(*process, instance_id, state_b64) || !FormatStateReference(state_b64, STATE_INLINE_MAX_LEN, reference))
+            {
+                DbgPrint(_T("Could not snapshot state for object %u. Keeping its host."), object_id);
+                return false;
+            }
+        }
+        HWND hwnd;
+        bool has_state;
+        HostState::DetachedHost detached;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            // 取得中に使われたか、GUI が開かれたか、状態が変わったか、ホストが再起動された
+            uint32_t current_serial = 0;
+            if (state.process != process || state.instance_id != instance_id || state.last_used_us != last_used_us || state.gui_visible ||
+                (has_serial && (!ReadStateSerial(state, current_serial) || current_serial != serial)))
+            {
+                if (needs_state)
+                    DiscardStateReference(reference);
+                DbgPrint(_T("Object %u was used while being evicted. Keeping its host."), object_id);
+                return false;
+            }
+            if (needs_state)
+                SetPendingState(state, std::move(reference));
+            detached = state.DetachForRestart();
+            state.evicted = true;
+            hwnd = state.notify_hwnd;
+            has_state = state.has_pending_state;
+        }
+        // インスタンスの破棄とプロセスの終了待ち (最大2秒) はロックを離してから行う
+        HostState::ReleaseDetachedHost(std::move(detached));
+        process.reset();
+        const uint64_t elapsed_ms = (stats_page::NowUs() - started) / 1000;
+        stats_page::Add(state.stats->evictions, 1);
+        stats_page::Add(state.stats->evictMs, elapsed_ms);
+        DbgPrint(_T("Evicted idle host for object %u in %llu ms."), object_id, elapsed_ms);
+        if (hwnd && has_state)
+            PostMessage(hwnd, WM_APP_STATE_SYNCED, object_id, 0);
+        return true;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+    bool stopping = false;
+};
+HostEvictor g_host_evictor;
+
+void StartHostEvictor()
+{
+    g_host_evictor.Start();
+}
+
+void StopHostEvictor()
+{
+    g_host_evictor.Stop();
+}
+
+// =================================================================
+// パイプ通信
+// =================================================================
+bool WritePipe(HostProcess &process, const void *data, size_t size)
+{
+    if (!process.pipe.Write(data, size))
+    {
+        DbgPrint(_T("Write to pipe failed. Error: %lu"), ipc_transport::LastError());
+        return false;
+    }
+    return true;
+}
+
+// 1回の読み出しで届くとは限らないため、size バイト揃うまで読み続ける
+bool ReadPipe(HostProcess &process, void *data, size_t size)
+{
+    if (!process.pipe.Read(data, size))
+    {
+        DbgPrint(_T("Read from pipe failed. Error: %lu"), ipc_transport::LastError());
+        return false;
+    }
+    return true;
+}
+
+// テキストプロトコル: 改行までを1つの応答として読む。収まらない応答は読み捨てて失敗とする
+bool ReadTextResponse(HostProcess &process, char *response, DWORD responseSize)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        size_t read = 0;
+        if (!process.pipe.ReadSome(response + total, responseSize - 1 - total, read))
+        {
+            DbgPrint(_T("Read from pipe failed. Error: %lu"), ipc_transport::LastError());
+            response[total] = '\0';
+            return false;
+        }
+        total += read;
+        response[total] = '\0';
+        if (total > 0 && response[total - 1] == '\n')
+            return true;
+        if (read == 0)
+            return false;
+        if (total == responseSize - 1)
+            break;
+    }
+    DbgPrint(_T("Response exceeds %lu bytes. Discarding the rest."), responseSize);
+    char discard[256];
+    size_t read = 0;
+    while (process.pipe.ReadSome(discard, sizeof(discard), read))
+    {
+        if (read == 0 || discard[read - 1] == '\n')
+            break;
+    }
+    return false;
+}
+
+// 改行までを可変長で読む。max_size を超える応答は残りを読み捨てて失敗にする
+bool ReadTextLine(HostProcess &process, std::string &line, size_t max_size)
+{
+    line.clear();
+    char chunk[4096];
+    for (;;)
+    {
+        size_t read = 0;
+        if (!process.pipe.ReadSome(chunk, sizeof(chunk), read))
+        {
+            DbgPrint(_T("Read from pipe failed. Error: %lu"), ipc_transport::LastError());
+            return false;
+        }
+        if (read == 0)
+            return false;
+        if (line.size() + read > max_size)
+        {
+            DbgPrint(_T("Response exceeds %zu bytes. Discarding the rest."), max_size);
+            while (chunk[read - 1] != '\n' && process.pipe.ReadSome(chunk, sizeof(chunk), read) && read > 0)
+            {
+            }
+            line.clear();
+            return false;
+        }
+        line.append(chunk, read);
+        if (line.back() == '\n')
+            return true;
+    }
+}
+
+// バイナリプロトコル: 1フレーム送信して1フレーム受信する
+bool ExchangeFrame(HostProcess &process, const std::vector<uint8_t> &frame, ipc_protocol::FrameHeader &reply, std::vector<uint8_t> &payload)
+{
+    TRACE_SPAN("pipe_frame");
+    uint8_t header[sizeof(ipc_protocol::FrameHeader)];
+    if (!WritePipe(process, frame.data(), frame.size()) || !ReadPipe(process, header, sizeof(header)))
+        return false;
+    if (ipc_protocol::DecodeHeader(header, sizeof(header), reply) != ipc_protocol::DecodeResult::ok)
+    {
+        DbgPrint(_T("Invalid frame header from host."));
+        return false;
+    }
+    payload.resize(reply.payload_size);
+    return ReadPipe(process, payload.data(), payload.size());
+}
+
+// 応答フレームをテキストプロトコルと同じ "OK ..." / "Error: ..." 形式に直す
+bool FormatFrameResponse(const ipc_protocol::FrameHeader &reply, const std::vector<uint8_t> &payload, char *response, DWORD responseSize)
+{
+    std::string text;
+    switch (static_cast<ipc_protocol::MessageType>(reply.type))
+    {
+    case ipc_protocol::MessageType::ok:
+        text = "OK";
+        if (!payload.empty())
+            text.append(" ").append(payload.begin(), payload.end());
+        break;
+    case ipc_protocol::MessageType::error:
+        text = "Error: ";
+        text.append(payload.begin(), payload.end());
+        break;
+    case ipc_protocol::MessageType::state:
+    {
+        std::string state_b64;
+        ipc_protocol::Base64Encode(payload.data(), payload.size(), state_b64);
+        text = "OK " + state_b64;
+        break;
+    }
+    default:
+        return false;
+    }
+    text += "\n";
+    if (text.size() >= responseSize)
+        return false;
+    memcpy(response, text.c_str(), text.size() + 1);
+    return true;
+}
+
+bool ExchangeCommand(HostProcess &process, int32_t instance_id, const char *command, char *response, DWORD responseSize)
+{
+    TRACE_SPAN("pipe_command", instance_id);
+    response[0] = '\0';
+    if (!process.pipe.IsOpen())
+        return false;
+    std::lock_guard<std::mutex> lock(process.pipe_mutex);
+    if (process.binary_protocol)
+    {
+        std::string_view text(command);
+        if (!text.empty() && text.back() == '\n')
+            text.remove_suffix(1);
+        std::vector<uint8_t> frame;
+        if (!ipc_protocol::EncodeFrame(ipc_protocol::MessageType::command, instance_id, text.data(), text.size(), frame))
+            return false;
+        ipc_protocol::FrameHeader reply;
+        std::vector<uint8_t> payload;
+        return ExchangeFrame(process, frame, reply, payload) && FormatFrameResponse(reply, payload, response, responseSize);
+    }
+    // メッセージ型のパイプで読むホストがあるため、コマンドは1回の書き込みで送る
+    if (instance_id >= 0)
+    {
+        std::string addressed = "@" + std::to_string(instance_id) + " " + command;
+        return WritePipe(process, addressed.c_str(), addressed.size()) && ReadTextResponse(process, response, responseSize);
+    }
+    return WritePipe(process, command, strlen(command)) && ReadTextResponse(process, response, responseSize);
+}
+
 bool SendCommandToHost(HostState &state, const char *command, char *response, DWORD responseSize)
 {
-    if (!state.host_running || state.hPipe == INVALID_HANDLE_VALUE)
+    if (!state.host_running || !state.process)
+        return false;
+    return ExchangeCommand(*state.process, state.instance_id, command, response, responseSize);
+}
+bool SendCommandToProcess(HostProcess &process, const char *command, char *response, DWORD responseSize)
+{
+    return ExchangeCommand(process, -1, command, response, responseSize);
+}
+
+// command の末尾に状態を付けて送る。バイナリプロトコルでは base64 を展開した生データを送る
+bool SendStateCommandToHost(HostState &state, const char *command, const std::string &state_b64, char *response, DWORD responseSize)
+{
+    if (!state.host_running || !state.process)
         return false;
+    HostProcess &process = *state.process;
+    if (!process.binary_protocol)
+    {
+        std::string text;
+        text.reserve(strlen(command) + state_b64.size() + 2);
+        text.append(command).append(" ").append(state_b64).append("\n");
+        return ExchangeCommand(process, state.instance_id, text.c_str(), response, responseSize);
+    }
     response[0] = '\0';
-    DWORD bytesWritten;
-    if (!WriteFile(state.hPipe, command, (DWORD)strlen(command), &bytesWritten, NULL))
+    std::vector<uint8_t> raw;
+    if (!ipc_protocol::Base64Decode(state_b64, raw))
+    {
+        DbgPrint(_T("Saved state is not valid base64."));
+        return false;
+    }
+    std::vector<uint8_t> frame;
+    if (!ipc_protocol::EncodeCommandWithState(state.instance_id, command, raw.data(), raw.size(), frame))
+    {
+        DbgPrint(_T("Saved state is too large for a frame (%zu bytes)."), raw.size());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(process.pipe_mutex);
+    ipc_protocol::FrameHeader reply;
+    std::vector<uint8_t> payload;
+    return ExchangeFrame(process, frame, reply, payload) && FormatFrameResponse(reply, payload, response, responseSize);
+}
+
+bool RequestStateFromHost(HostState &state, std::string &state_b64)
+{
+    if (!state.host_running || !state.process)
+        return false;
+    return RequestStateFromProcess(*state.process, state.instance_id, state_b64);
+}
+
+bool RequestStateFromProcess(HostProcess &process, int32_t instance_id, std::string &state_b64)
+{
+    if (!process.binary_protocol)
+    {
+        // 状態は外部ストアに逃がせるので、応答はバイナリプロトコルと同じ上限まで受け付ける
+        constexpr size_t MAX_STATE_RESPONSE = (ipc_protocol::MAX_PAYLOAD_SIZE + 2) / 3 * 4 + 4;
+        std::string command = "get_state\n";
+        if (instance_id >= 0)
+            command = "@" + std::to_string(instance_id) + " " + command;
+        std::string response;
+        {
+            TRACE_SPAN("pipe_command", instance_id);
+            if (!process.pipe.IsOpen())
+                return false;
+            std::lock_guard<std::mutex> lock(process.pipe_mutex);
+            if (!WritePipe(process, command.c_str(), command.size()) || !ReadTextLine(process, response, MAX_STATE_RESPONSE))
+            {
+                DbgPrint(_T("Failed to get state."));
+                return false;
+            }
+        }
+        if (response.compare(0, 3, "OK ") != 0)
+        {
+            response.pop_back();
+            DbgPrint(_T("Failed to get state: %hs"), response.c_str());
+            return false;
+        }
+        state_b64.assign(response, 3, response.size() - 4);
+        return true;
+    }
+    std::vector<uint8_t> frame;
+    ipc_protocol::EncodeFrame(ipc_protocol::MessageType::command, instance_id, "get_state", 9, frame);
+    std::lock_guard<std::mutex> lock(process.pipe_mutex);
+    ipc_protocol::FrameHeader reply;
+    std::vector<uint8_t> payload;
+    if (!ExchangeFrame(process, frame, reply, payload))
         return false;
-    DWORD bytesRead;
-    if (!ReadFile(state.hPipe, response, responseSize - 1, &bytesRead, NULL))
+    if (static_cast<ipc_protocol::MessageType>(reply.type) != ipc_protocol::MessageType::state)
     {
-        DbgPrint(_T("ReadFile from pipe failed. Error: %lu"), GetLastError());
+        DbgPrint(_T("Unexpected reply type %u to get_state."), reply.type);
         return false;
     }
-    response[bytesRead] = '\0';
+    ipc_protocol::Base64Encode(payload.data(), payload.size(), state_b64);
     return true;
 }
 BOOL WINAPI DllMain(HINSTANCE hinst, DWORD fdwReason, LPVOID)
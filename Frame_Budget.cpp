@@ -0,0 +1,75 @@
+#include "Frame_Budget.h"
+#include <algorithm>
+#include <cmath>
+
+namespace frame_budget
+{
+    void RoundTripEstimator::Add(uint64_t us)
+    {
+        const double sample = static_cast<double>(us);
+        if (samples++ == 0)
+        {
+            srtt_us = sample;
+            rttvar_us = sample / 2;
+            return;
+        }
+        rttvar_us += (std::abs(srtt_us - sample) - rttvar_us) / 4;
+        srtt_us += (sample - srtt_us) / 8;
+    }
+
+    void RoundTripEstimator::Reset()
+    {
+        srtt_us = 0;
+        rttvar_us = 0;
+        samples = 0;
+    }
+
+    uint32_t RoundTripEstimator::TimeoutMs(uint32_t cap_ms) const
+    {
+        if (samples == 0)
+            return cap_ms;
+        const double ms = std::ceil((srtt_us + 4 * rttvar_us) / 1000);
+        return static_cast<uint32_t>(std::clamp(ms, static_cast<double>(std::min(MIN_BLOCK_TIMEOUT_MS, cap_ms)), static_cast<double>(cap_ms)));
+    }
+
+    uint64_t RoundTripEstimator::PredictUs(int blocks) const
+    {
+        return static_cast<uint64_t>(srtt_us * std::max(blocks, 0));
+    }
+
+    void RoundTripEstimator::Decay()
+    {
+        srtt_us *= 0.75;
+        rttvar_us *= 0.75;
+    }
+
+    void Scheduler::Enter(int frame, uint64_t now_us, uint32_t frame_ms, uint32_t budget_ms)
+    {
+        const uint64_t stale_at = started_us + budget_us + static_cast<uint64_t>(frame_ms) * 1000;
+        if (frame == current_frame && now_us < stale_at && budget_us == static_cast<uint64_t>(budget_ms) * 1000)
+            return;
+        current_frame = frame;
+        started_us = now_us;
+        budget_us = static_cast<uint64_t>(budget_ms) * 1000;
+    }
+
+    void Scheduler::Extend(uint64_t us)
+    {
+        started_us += us;
+    }
+
+    uint64_t Scheduler::RemainingUs(uint64_t now_us) const
+    {
+        if (Unlimited())
+            return UINT64_MAX;
+        const uint64_t deadline = started_us + budget_us;
+        return now_us < deadline ? deadline - now_us : 0;
+    }
+
+    uint32_t Scheduler::RemainingMs(uint64_t now_us) const
+    {
+        if (Unlimited())
+            return UINT32_MAX;
+        return static_cast<uint32_t>(std::min<uint64_t>((RemainingUs(now_us) + 999) / 1000, UINT32_MAX));
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+
+// =================================================================
+// フレーム単位の処理時間の予算
+// =================================================================
+// 同じフレームで処理されるオブジェクト全体で1つの締め切りを共有し、
+// 各ブロックの待ち時間をその残りで打ち切ります。加えてホストごとの往復時間を
+// 平滑化しておき、残りの予算で処理しきれない見込みのオブジェクトは
+// 待たずに素通しさせます。時刻はすべて呼び出し側が渡すマイクロ秒です。
+namespace frame_budget
+{
+    // 往復時間から決めるブロックの待ち時間の下限
+    constexpr uint32_t MIN_BLOCK_TIMEOUT_MS = 5;
+
+    // RFC 6298 (TCP の再送タイムアウト) と同じ方法で往復時間とそのばらつきを平滑化する
+    class RoundTripEstimator
+    {
+    public:
+        void Add(uint64_t us);
+        void Reset();
+        bool HasSamples() const { return samples > 0; }
+        // srtt + 4 * rttvar を [MIN_BLOCK_TIMEOUT_MS, cap_ms] に収めた値。履歴がなければ cap_ms
+        uint32_t TimeoutMs(uint32_t cap_ms) const;
+        // blocks 個のブロックを処理するのにかかる見込み時間
+        uint64_t PredictUs(int blocks) const;
+        // 予算不足で処理を見送ったときに呼ぶ。見積もりを縮め、いずれ再び処理を試みるようにする
+        void Decay();
+
+    private:
+        double srtt_us = 0;
+        double rttvar_us = 0;
+        uint64_t samples = 0;
+    };
+
+    // func_proc からのみ使うため排他はしない
+    class Scheduler
+    {
+    public:
+        // オブジェクトの処理の前に呼ぶ。フレームが変わったか、同じフレームでも
+        // 締め切りから frame_ms 以上過ぎていれば (描画し直し) 新しい予算を始める。
+        // budget_ms が 0 なら予算を設けない
+        void Enter(int frame, uint64_t now_us, uint32_t frame_ms, uint32_t budget_ms);
+        // プリロールのように聞こえる出力を作らない処理にかかった時間だけ締め切りを遅らせる
+        void Extend(uint64_t us);
+        bool Unlimited() const { return budget_us == 0; }
+        uint64_t BudgetUs() const { return budget_us; }
+        uint64_t RemainingUs(uint64_t now_us) const;
+        uint32_t RemainingMs(uint64_t now_us) const;
+
+    private:
+        int current_frame = INT_MIN;
+        uint64_t started_us = 0;
+        uint64_t budget_us = 0;
+    };
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Trace.h"
+
+// =================================================================
+// オブジェクトごとの状態の登録簿と起動スレッド
+// =================================================================
+// Registry のロックは検索・追加・削除の間だけ保持し、ホストとの通信は
+// 各状態が持つロックの下で行います。状態の破棄にはホストとの通信が伴うため、
+// 取り除いた状態は呼び出し側に返し、最後の参照はロックの外で手放させます。
+// Windows に依存しないため、モックホストを使ったテストでも同じものを使います。
+namespace host_registry
+{
+    template <class State>
+    class Registry
+    {
+    public:
+        using Entry = std::pair<uint32_t, std::shared_ptr<State>>;
+
+        std::shared_ptr<State> Find(uint32_t id)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = states.find(id);
+            return it != states.end() ? it->second : nullptr;
+        }
+
+        // 登録されていなければ nullptr
+        std::shared_ptr<State> Remove(uint32_t id)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = states.find(id);
+            if (it == states.end())
+                return nullptr;
+            std::shared_ptr<State> removed = std::move(it->second);
+            states.erase(it);
+            return removed;
+        }
+
+        // 登録済みの状態が matches(state) を満たさなければ create() で作り直し、古い状態を replaced に返す
+        template <class Matches, class Create>
+        std::shared_ptr<State> Acquire(uint32_t id, Matches &&matches, Create &&create, std::shared_ptr<State> &replaced)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &slot = states[id];
+            if (slot && !matches(*slot))
+                replaced = std::move(slot);
+            if (!slot)
+                slot = create();
+            return slot;
+        }
+
+        // 巡回用の写し。写した後に削除された状態も含まれます
+        std::vector<Entry> Snapshot()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::vector<Entry>(states.begin(), states.end());
+        }
+
+        // すべて取り除いて返す
+        std::vector<Entry> Clear()
+        {
+            std::unordered_map<uint32_t, std::shared_ptr<State>> removed;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                removed.swap(states);
+            }
+            return std::vector<Entry>(std::make_move_iterator(removed.begin()), std::make_move_iterator(removed.end()));
+        }
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<uint32_t, std::shared_ptr<State>> states;
+    };
+
+    // 起動要求を1本のスレッドで順に処理する。接続の待機などで要求元のスレッドを止めないため
+    template <class Request>
+    class Launcher
+    {
+    public:
+        using LaunchFunction = void (*)(Request &request);
+
+        Launcher(const char *thread_name, LaunchFunction launch) : thread_name(thread_name), launch(launch) {}
+        Launcher(const Launcher &) = delete;
+        Launcher &operator=(const Launcher &) = delete;
+        ~Launcher() { Stop(); }
+
+        void Submit(Request request)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable())
+            {
+                stopping = false;
+                worker = std::thread([this]
+                                     { Run(); });
+            }
+            queue.push_back(std::move(request));
+            cv.notify_one();
+        }
+
+        // 処理中の要求は完了を待ち、未処理の要求は捨てる
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+            if (worker.joinable())
+                worker.join();
+            std::deque<Request> dropped;
+            std::lock_guard<std::mutex> lock(mutex);
+            dropped.swap(queue);
+        }
+
+    private:
+        void Run()
+        {
+            trace::SetThreadName(thread_name);
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                cv.wait(lock, [this]
+                        { return stopping || !queue.empty(); });
+                if (stopping)
+                    break;
+                {
+                    Request request = std::move(queue.front());
+                    queue.pop_front();
+                    lock.unlock();
+                    launch(request);
+                }
+                lock.lock();
+            }
+        }
+
+        const char *thread_name;
+        LaunchFunction launch;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Request> queue;
+        std::thread worker;
+        bool stopping = false;
+    };
+}
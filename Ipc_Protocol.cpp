@@ -0,0 +1,132 @@
+#include "Ipc_Protocol.h"
+#include <cstring>
+
+namespace ipc_protocol
+{
+    namespace
+    {
+        constexpr char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        struct Base64Table
+        {
+            int8_t values[256];
+            constexpr Base64Table() : values()
+            {
+                for (int i = 0; i < 256; ++i)
+                    values[i] = -1;
+                for (int i = 0; i < 64; ++i)
+                    values[static_cast<unsigned char>(BASE64_CHARS[i])] = static_cast<int8_t>(i);
+            }
+        };
+        constexpr Base64Table BASE64_TABLE;
+
+        void AppendHeader(MessageType type, int32_t instance_id, size_t size, std::vector<uint8_t> &out)
+        {
+            FrameHeader header = {MAGIC, VERSION, static_cast<uint16_t>(type), instance_id, static_cast<uint32_t>(size)};
+            out.resize(sizeof(header));
+            memcpy(out.data(), &header, sizeof(header));
+        }
+    }
+
+    bool EncodeFrame(MessageType type, int32_t instance_id, const void *payload, size_t size, std::vector<uint8_t> &out)
+    {
+        if (size > MAX_PAYLOAD_SIZE)
+            return false;
+        AppendHeader(type, instance_id, size, out);
+        auto *bytes = static_cast<const uint8_t *>(payload);
+        out.insert(out.end(), bytes, bytes + size);
+        return true;
+    }
+
+    bool EncodeCommandWithState(int32_t instance_id, std::string_view command, const void *state, size_t state_size, std::vector<uint8_t> &out)
+    {
+        if (command.size() > MAX_PAYLOAD_SIZE || state_size > MAX_PAYLOAD_SIZE - sizeof(uint32_t) - command.size())
+            return false;
+        const uint32_t command_size = static_cast<uint32_t>(command.size());
+        out.reserve(sizeof(FrameHeader) + sizeof(command_size) + command.size() + state_size);
+        AppendHeader(MessageType::command_with_state, instance_id, sizeof(command_size) + command.size() + state_size, out);
+        auto *size_bytes = reinterpret_cast<const uint8_t *>(&command_size);
+        out.insert(out.end(), size_bytes, size_bytes + sizeof(command_size));
+        out.insert(out.end(), command.begin(), command.end());
+        auto *state_bytes = static_cast<const uint8_t *>(state);
+        out.insert(out.end(), state_bytes, state_bytes + state_size);
+        return true;
+    }
+
+    DecodeResult DecodeHeader(const void *data, size_t size, FrameHeader &header)
+    {
+        if (size < sizeof(header))
+            return DecodeResult::truncated;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC)
+            return DecodeResult::bad_magic;
+        if (header.version != VERSION)
+            return DecodeResult::bad_version;
+        if (header.payload_size > MAX_PAYLOAD_SIZE)
+            return DecodeResult::too_large;
+        return DecodeResult::ok;
+    }
+
+    bool SplitCommandWithState(const uint8_t *payload, size_t size, std::string_view &command, const uint8_t *&state, size_t &state_size)
+    {
+        uint32_t command_size;
+        if (size < sizeof(command_size))
+            return false;
+        memcpy(&command_size, payload, sizeof(command_size));
+        if (command_size > size - sizeof(command_size))
+            return false;
+        command = std::string_view(reinterpret_cast<const char *>(payload + sizeof(command_size)), command_size);
+        state = payload + sizeof(command_size) + command_size;
+        state_size = size - sizeof(command_size) - command_size;
+        return true;
+    }
+
+    bool Base64Decode(std::string_view src, std::vector<uint8_t> &out)
+    {
+        out.clear();
+        out.reserve(src.size() / 4 * 3);
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (char c : src)
+        {
+            if (c == '=')
+                break;
+            int value = BASE64_TABLE.values[static_cast<unsigned char>(c)];
+            if (value < 0)
+                return false;
+            buffer = (buffer << 6) | static_cast<uint32_t>(value);
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                out.push_back(static_cast<uint8_t>(buffer >> bits));
+            }
+        }
+        return true;
+    }
+
+    void Base64Encode(const uint8_t *src, size_t size, std::string &out)
+    {
+        out.clear();
+        out.reserve((size + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 3 <= size; i += 3)
+        {
+            uint32_t v = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+            out.push_back(BASE64_CHARS[(v >> 18) & 63]);
+            out.push_back(BASE64_CHARS[(v >> 12) & 63]);
+            out.push_back(BASE64_CHARS[(v >> 6) & 63]);
+            out.push_back(BASE64_CHARS[v & 63]);
+        }
+        if (i < size)
+        {
+            uint32_t v = src[i] << 16;
+            if (i + 1 < size)
+                v |= src[i + 1] << 8;
+            out.push_back(BASE64_CHARS[(v >> 18) & 63]);
+            out.push_back(BASE64_CHARS[(v >> 12) & 63]);
+            out.push_back(i + 1 < size ? BASE64_CHARS[(v >> 6) & 63] : '=');
+            out.push_back('=');
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =================================================================
+// パイプ上のバイナリプロトコル (host_caps::binary)
+// =================================================================
+// 各メッセージは FrameHeader (16バイト, リトルエンディアン) と payload_size バイトの
+// ペイロードで構成されます。状態は base64 ではなく生のバイト列のまま送ります。
+namespace ipc_protocol
+{
+    constexpr uint32_t MAGIC = 0x42485041; // "APHB"
+    constexpr uint16_t VERSION = 1;
+    constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+    enum class MessageType : uint16_t
+    {
+        command = 1,        // コマンド文字列 (UTF-8, 改行なし)
+        command_with_state, // [uint32 コマンド長][コマンド文字列][状態]
+        ok,                 // "OK" に続く文字列 (空でも可)
+        error,              // エラーメッセージ
+        state,              // 状態 (get_state の応答)
+    };
+
+#pragma pack(push, 1)
+    struct FrameHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t type;        // MessageType
+        int32_t instance_id;  // -1: プロセス宛て
+        uint32_t payload_size;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(FrameHeader) == 16);
+
+    // ペイロードが MAX_PAYLOAD_SIZE を超える場合は out を変更せずに false を返します
+    bool EncodeFrame(MessageType type, int32_t instance_id, const void *payload, size_t size, std::vector<uint8_t> &out);
+    bool EncodeCommandWithState(int32_t instance_id, std::string_view command, const void *state, size_t state_size, std::vector<uint8_t> &out);
+
+    enum class DecodeResult
+    {
+        ok,
+        truncated,
+        bad_magic,
+        bad_version,
+        too_large,
+    };
+    // size は data から読めるバイト数。ヘッダー1つ分に満たなければ truncated
+    DecodeResult DecodeHeader(const void *data, size_t size, FrameHeader &header);
+    bool SplitCommandWithState(const uint8_t *payload, size_t size, std::string_view &command, const uint8_t *&state, size_t &state_size);
+
+    // exdata の保存形式 (base64) との変換
+    bool Base64Decode(std::string_view src, std::vector<uint8_t> &out);
+    void Base64Encode(const uint8_t *src, size_t size, std::string &out);
+}
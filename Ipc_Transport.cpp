@@ -0,0 +1,472 @@
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "Ipc_Transport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Spin_Signal.h"
+#endif
+
+namespace ipc_transport
+{
+#ifdef _WIN32
+    // =================================================================
+    // Windows
+    // =================================================================
+    uint32_t LastError()
+    {
+        return GetLastError();
+    }
+
+    bool SharedMemory::Create(const char *name, size_t size)
+    {
+        Close();
+        const uint64_t size64 = size;
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), name);
+        if (!mapping)
+            return false;
+        data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (!data)
+        {
+            Close();
+            return false;
+        }
+        this->size = size;
+        return true;
+    }
+
+    bool SharedMemory::Open(const char *name, size_t size)
+    {
+        Close();
+        mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+        if (!mapping)
+            return false;
+        data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (!data)
+        {
+            Close();
+            return false;
+        }
+        if (size == 0)
+        {
+            MEMORY_BASIC_INFORMATION info = {};
+            VirtualQuery(data, &info, sizeof(info));
+            size = info.RegionSize;
+        }
+        this->size = size;
+        return true;
+    }
+
+    void SharedMemory::Close()
+    {
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        data = nullptr;
+        size = 0;
+        mapping = NULL;
+    }
+
+    bool Signal::Create(const char *name)
+    {
+        Close();
+        handle = CreateEventA(NULL, FALSE, FALSE, name);
+        return handle != NULL;
+    }
+
+    bool Signal::Open(const char *name)
+    {
+        Close();
+        handle = OpenEventA(EVENT_ALL_ACCESS, FALSE, name);
+        return handle != NULL;
+    }
+
+    void Signal::Close()
+    {
+        if (handle)
+            CloseHandle(handle);
+        handle = NULL;
+    }
+
+    bool Signal::IsOpen() const
+    {
+        return handle != NULL;
+    }
+
+    void Signal::Set()
+    {
+        SetEvent(handle);
+    }
+
+    void Signal::Reset()
+    {
+        ResetEvent(handle);
+    }
+
+    WaitResult Signal::Wait(uint32_t timeout_ms)
+    {
+        switch (WaitForSingleObject(handle, timeout_ms))
+        {
+        case WAIT_OBJECT_0:
+            return WaitResult::signaled;
+        case WAIT_TIMEOUT:
+            return WaitResult::timeout;
+        default:
+            return WaitResult::failed;
+        }
+    }
+
+    bool Channel::Connect(const char *name, uint32_t timeout_ms)
+    {
+        Close();
+        const ULONGLONG deadline = GetTickCount64() + timeout_ms;
+        for (;;)
+        {
+            pipe = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+            if (pipe != INVALID_HANDLE_VALUE)
+                return true;
+            if (GetTickCount64() >= deadline)
+                return false;
+            if (GetLastError() == ERROR_PIPE_BUSY)
+                WaitNamedPipeA(name, 1000);
+            else
+                Sleep(100);
+        }
+    }
+
+    bool Channel::Listen(const char *name)
+    {
+        Close();
+        pipe = CreateNamedPipeA(name, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1, 65536, 65536, 0, NULL);
+        return pipe != INVALID_HANDLE_VALUE;
+    }
+
+    bool Channel::Accept()
+    {
+        return ConnectNamedPipe(pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED;
+    }
+
+    void Channel::Close()
+    {
+        if (pipe != INVALID_HANDLE_VALUE)
+            CloseHandle(pipe);
+        pipe = INVALID_HANDLE_VALUE;
+    }
+
+    bool Channel::IsOpen() const
+    {
+        return pipe != INVALID_HANDLE_VALUE;
+    }
+
+    bool Channel::Write(const void *data, size_t size)
+    {
+        auto *bytes = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            DWORD written = 0;
+            if (!WriteFile(pipe, bytes, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &written, NULL))
+                return false;
+            bytes += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    bool Channel::ReadSome(void *data, size_t size, size_t &read)
+    {
+        DWORD count = 0;
+        read = 0;
+        if (!ReadFile(pipe, data, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &count, NULL) && GetLastError() != ERROR_MORE_DATA)
+            return false;
+        read = count;
+        return true;
+    }
+#else
+    // =================================================================
+    // POSIX
+    // =================================================================
+    namespace
+    {
+        const char *LeafName(const char *name)
+        {
+            const char *leaf = name;
+            for (const char *p = name; *p; ++p)
+            {
+                if (*p == '\\' || *p == '/')
+                    leaf = p + 1;
+            }
+            return leaf;
+        }
+
+        std::string ShmName(const char *name)
+        {
+            return std::string("/") + LeafName(name);
+        }
+
+        bool SocketAddress(const char *name, sockaddr_un &address, std::string &path)
+        {
+            const char *dir = getenv("XDG_RUNTIME_DIR");
+            path = std::string(dir && *dir ? dir : "/tmp") + "/" + LeafName(name);
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                errno = ENAMETOOLONG;
+                return false;
+            }
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+    }
+
+    uint32_t LastError()
+    {
+        return static_cast<uint32_t>(errno);
+    }
+
+    bool SharedMemory::Create(const char *name, size_t size)
+    {
+        Close();
+        const std::string shm_name = ShmName(name);
+        int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0)
+            return false;
+        // Windows と同じく、既にある場合は縮めずにそのまま使う
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) != 0))
+        {
+            close(fd);
+            return false;
+        }
+        void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+        data = mapped;
+        this->size = size;
+        unlink_name = shm_name;
+        return true;
+    }
+
+    bool SharedMemory::Open(const char *name, size_t size)
+    {
+        Close();
+        int fd = shm_open(ShmName(name).c_str(), O_RDWR, 0);
+        if (fd < 0)
+            return false;
+        struct stat info = {};
+        if (size == 0 && fstat(fd, &info) == 0)
+            size = static_cast<size_t>(info.st_size);
+        void *mapped = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+        data = mapped;
+        this->size = size;
+        return true;
+    }
+
+    void SharedMemory::Close()
+    {
+        if (data)
+            munmap(data, size);
+        if (!unlink_name.empty())
+            shm_unlink(unlink_name.c_str());
+        data = nullptr;
+        size = 0;
+        unlink_name.clear();
+    }
+
+    // イベントは共有メモリ上の 32 ビット値 (1: シグナル状態) で表し、futex で待つ
+    bool Signal::Create(const char *name)
+    {
+        return word.Create(name, sizeof(uint32_t));
+    }
+
+    bool Signal::Open(const char *name)
+    {
+        return word.Open(name, sizeof(uint32_t));
+    }
+
+    void Signal::Close()
+    {
+        word.Close();
+    }
+
+    bool Signal::IsOpen() const
+    {
+        return word.Data() != nullptr;
+    }
+
+    void Signal::Set()
+    {
+        auto *value = static_cast<uint32_t *>(word.Data());
+        std::atomic_ref<uint32_t>(*value).store(1, std::memory_order_release);
+#ifdef __linux__
+        spin_signal::FutexWake(value);
+#endif
+    }
+
+    void Signal::Reset()
+    {
+        std::atomic_ref<uint32_t>(*static_cast<uint32_t *>(word.Data())).store(0, std::memory_order_release);
+    }
+
+    WaitResult Signal::Wait(uint32_t timeout_ms)
+    {
+        using clock = std::chrono::steady_clock;
+        auto *value = static_cast<uint32_t *>(word.Data());
+        if (!value)
+            return WaitResult::failed;
+        std::atomic_ref<uint32_t> state(*value);
+        const auto deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;)
+        {
+            uint32_t expected = 1;
+            if (state.compare_exchange_strong(expected, 0, std::memory_order_acquire))
+                return WaitResult::signaled;
+            const auto now = clock::now();
+            if (now >= deadline)
+                return WaitResult::timeout;
+#ifdef __linux__
+            spin_signal::FutexWait(value, 0, static_cast<uint32_t>(std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count()));
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+        }
+    }
+
+    bool Channel::Connect(const char *name, uint32_t timeout_ms)
+    {
+        Close();
+        sockaddr_un address;
+        std::string path;
+        if (!SocketAddress(name, address, path))
+            return false;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;)
+        {
+            socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (socket_fd < 0)
+                return false;
+            if (connect(socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+                return true;
+            const int error = errno;
+            close(socket_fd);
+            socket_fd = -1;
+            errno = error;
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    bool Channel::Listen(const char *name)
+    {
+        Close();
+        sockaddr_un address;
+        if (!SocketAddress(name, address, listen_path))
+            return false;
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+            return false;
+        unlink(listen_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listen_fd, 1) != 0)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // 名前付きパイプと同じく1つ目の接続だけを受け付け、以降の接続はできなくする
+    bool Channel::Accept()
+    {
+        do
+            socket_fd = accept(listen_fd, nullptr, nullptr);
+        while (socket_fd < 0 && errno == EINTR);
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(listen_path.c_str());
+        return socket_fd >= 0;
+    }
+
+    void Channel::Close()
+    {
+        if (socket_fd >= 0)
+            close(socket_fd);
+        if (listen_fd >= 0)
+        {
+            close(listen_fd);
+            unlink(listen_path.c_str());
+        }
+        socket_fd = -1;
+        listen_fd = -1;
+    }
+
+    bool Channel::IsOpen() const
+    {
+        return socket_fd >= 0;
+    }
+
+    bool Channel::Write(const void *data, size_t size)
+    {
+        auto *bytes = static_cast<const char *>(data);
+        while (size > 0)
+        {
+            ssize_t written = send(socket_fd, bytes, size, MSG_NOSIGNAL);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool Channel::ReadSome(void *data, size_t size, size_t &read)
+    {
+        read = 0;
+        for (;;)
+        {
+            ssize_t count = recv(socket_fd, data, size, 0);
+            if (count >= 0)
+            {
+                read = static_cast<size_t>(count);
+                return true;
+            }
+            if (errno != EINTR)
+                return false;
+        }
+    }
+#endif
+
+    bool Channel::Read(void *data, size_t size)
+    {
+        auto *bytes = static_cast<char *>(data);
+        while (size > 0)
+        {
+            size_t read = 0;
+            if (!ReadSome(bytes, size, read) || read == 0)
+                return false;
+            bytes += read;
+            size -= read;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <string>
+#endif
+
+// =================================================================
+// プロセス間通信の下回り
+// =================================================================
+// コマンド用のバイトストリーム、共有メモリ、自動リセットのイベントを
+// OS ごとの実装で提供します。ブロック処理とコマンドの送受信はこのクラス
+// だけを使うため、どちらの実装の上でもそのまま動きます。
+//   Windows: 名前付きパイプ / ファイルマッピング / イベント
+//   POSIX  : Unix ドメインソケット / shm_open + mmap / 共有メモリ上の futex
+//
+// 名前は Windows の形式 ("\\.\pipe\...", "Local\...") のまま渡せます。POSIX では
+// 最後の区切り文字より後ろだけを使い、共有メモリは "/<名前>"、ソケットは
+// $XDG_RUNTIME_DIR (なければ /tmp) 以下のファイルになります。
+namespace ipc_transport
+{
+    enum class WaitResult
+    {
+        signaled,
+        timeout,
+        failed,
+    };
+
+    // 直近に失敗した呼び出しのエラーコード (GetLastError / errno)
+    uint32_t LastError();
+
+    class SharedMemory
+    {
+    public:
+        SharedMemory() = default;
+        SharedMemory(const SharedMemory &) = delete;
+        SharedMemory &operator=(const SharedMemory &) = delete;
+        ~SharedMemory() { Close(); }
+
+        // 同じ名前のものが既にあればそれを開きます
+        bool Create(const char *name, size_t size);
+        // size が 0 の場合は全体を割り当てます
+        bool Open(const char *name, size_t size);
+        void Close();
+        void *Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        void *data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        HANDLE mapping = NULL;
+#else
+        std::string unlink_name; // 作成した側だけが Close で名前を消す
+#endif
+    };
+
+    // 名前付きの自動リセットイベント。Wait で起床した時点で非シグナル状態に戻ります
+    class Signal
+    {
+    public:
+        Signal() = default;
+        Signal(const Signal &) = delete;
+        Signal &operator=(const Signal &) = delete;
+        ~Signal() { Close(); }
+
+        bool Create(const char *name);
+        bool Open(const char *name);
+        void Close();
+        bool IsOpen() const;
+        void Set();
+        void Reset();
+        WaitResult Wait(uint32_t timeout_ms);
+
+    private:
+#ifdef _WIN32
+        HANDLE handle = NULL;
+#else
+        SharedMemory word;
+#endif
+    };
+
+    // 1対1のバイトストリーム。書き込みと読み出しはそれぞれ1スレッドから行ってください
+    class Channel
+    {
+    public:
+        Channel() = default;
+        Channel(const Channel &) = delete;
+        Channel &operator=(const Channel &) = delete;
+        ~Channel() { Close(); }
+
+        // クライアント側: サーバーが Listen するまで timeout_ms 待って接続する
+        bool Connect(const char *name, uint32_t timeout_ms);
+        // サーバー側: 接続を1つだけ受け付ける
+        bool Listen(const char *name);
+        bool Accept();
+        void Close();
+        bool IsOpen() const;
+
+        bool Write(const void *data, size_t size);
+        // size バイト揃うまで読む。途中で切断されたら false
+        bool Read(void *data, size_t size);
+        // 届いている分だけ読む。切断時は read = 0 で true を返します
+        bool ReadSome(void *data, size_t size, size_t &read);
+
+    private:
+#ifdef _WIN32
+        HANDLE pipe = INVALID_HANDLE_VALUE;
+#else
+        int socket_fd = -1;
+        int listen_fd = -1;
+        std::string listen_path;
+#endif
+    };
+}
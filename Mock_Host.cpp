@@ -0,0 +1,282 @@
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include "Ipc_Transport.h"
+#include "Shared_Layout.h"
+
+// =================================================================
+// 動作確認用のモックホスト
+// =================================================================
+// README の「独自ホストプログラムの作成」に従うスタンドアロンEXEホストで、音声をそのまま返します。
+// 処理時間・揺らぎ・クラッシュを設定で再現できるため、実際のプラグインなしで
+// 統計ページ (Stats_Reader) やトレースを使ってプラグイン側の性能を調べられます。
+//
+// 設定は exe と同じ名前の .ini の [Mock] セクション、またはコマンドライン引数で指定します。
+// 通信は Ipc_Transport を使うため POSIX でもビルドでき、その場合はコマンドライン引数だけを読みます。
+//   CostUs / -cost_us <n>           : 1ブロックごとに n マイクロ秒 CPU を使う
+//   JitterUs / -jitter_us <n>       : 1ブロックごとに 0〜n マイクロ秒ランダムに眠る
+//   CrashAfterBlocks / -crash_after <n> : n ブロック処理した時点で異常終了する
+//   LatencySamples / -latency <n>   : get_latency で報告する遅延
+//   TailSamples / -tail <n>         : get_tail で報告する余韻の長さ (負の値で無限)
+namespace
+{
+    constexpr int LEGACY_BLOCK_SIZE = 2048;
+    constexpr size_t LEGACY_SHARED_SIZE = sizeof(AudioSharedData) + 4 * LEGACY_BLOCK_SIZE * sizeof(float);
+    constexpr char DEFAULT_STATE_B64[] = "bW9jaw=="; // "mock"
+
+    struct Options
+    {
+        unsigned long long uid = 0;
+        std::string pipe_base;
+        std::string shm_base;
+        std::string ready_base;
+        std::string done_base;
+        int cost_us = 0;
+        int jitter_us = 0;
+        int crash_after = 0;
+        int latency = 0;
+        int tail = 0;
+    };
+
+    Options g_options;
+    ipc_transport::Channel g_pipe;
+    ipc_transport::Signal g_event_ready;
+    ipc_transport::Signal g_event_done;
+    ipc_transport::SharedMemory g_shared;
+    ipc_transport::SharedMemory g_ring_mapping;
+    std::atomic<RingHeader *> g_ring = nullptr;
+    std::atomic<bool> g_quit = false;
+    std::string g_state = DEFAULT_STATE_B64;
+
+    void LoadOptions(int argc, char **argv)
+    {
+#ifdef _WIN32
+        char ini_path[MAX_PATH];
+        GetModuleFileNameA(NULL, ini_path, MAX_PATH);
+        if (char *dot = strrchr(ini_path, '.'))
+            strcpy_s(dot, MAX_PATH - (dot - ini_path), ".ini");
+        g_options.cost_us = GetPrivateProfileIntA("Mock", "CostUs", 0, ini_path);
+        g_options.jitter_us = GetPrivateProfileIntA("Mock", "JitterUs", 0, ini_path);
+        g_options.crash_after = GetPrivateProfileIntA("Mock", "CrashAfterBlocks", 0, ini_path);
+        g_options.latency = GetPrivateProfileIntA("Mock", "LatencySamples", 0, ini_path);
+        g_options.tail = GetPrivateProfileIntA("Mock", "TailSamples", 0, ini_path);
+#endif
+
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string key = argv[i];
+            const char *value = argv[i + 1];
+            if (key == "-uid")
+                g_options.uid = strtoull(value, nullptr, 10);
+            else if (key == "-pipe")
+                g_options.pipe_base = value;
+            else if (key == "-shm")
+                g_options.shm_base = value;
+            else if (key == "-event_ready")
+                g_options.ready_base = value;
+            else if (key == "-event_done")
+                g_options.done_base = value;
+            else if (key == "-cost_us")
+                g_options.cost_us = atoi(value);
+            else if (key == "-jitter_us")
+                g_options.jitter_us = atoi(value);
+            else if (key == "-crash_after")
+                g_options.crash_after = atoi(value);
+            else if (key == "-latency")
+                g_options.latency = atoi(value);
+            else if (key == "-tail")
+                g_options.tail = atoi(value);
+        }
+    }
+
+    std::string IpcName(const std::string &base)
+    {
+        return base + "_" + std::to_string(g_options.uid);
+    }
+
+    bool CreateIpc()
+    {
+        return g_pipe.Listen(IpcName(g_options.pipe_base).c_str()) &&
+               g_shared.Create(IpcName(g_options.shm_base).c_str(), LEGACY_SHARED_SIZE) &&
+               g_event_ready.Create(IpcName(g_options.ready_base).c_str()) &&
+               g_event_done.Create(IpcName(g_options.done_base).c_str());
+    }
+
+    // ブロックごとの擬似的な処理時間とクラッシュ
+    void SimulateCost()
+    {
+        static std::mt19937 random(std::random_device{}());
+        static unsigned long long blocks = 0;
+        if (g_options.crash_after > 0 && ++blocks >= static_cast<unsigned long long>(g_options.crash_after))
+            std::_Exit(3);
+        if (g_options.cost_us > 0)
+        {
+            auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(g_options.cost_us);
+            while (std::chrono::steady_clock::now() < end)
+            {
+            }
+        }
+        if (g_options.jitter_us > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(std::uniform_int_distribution<int>(0, g_options.jitter_us)(random)));
+    }
+
+    void ProcessLegacy()
+    {
+        auto *data = static_cast<AudioSharedData *>(g_shared.Data());
+        auto *buffer = reinterpret_cast<float *>(data + 1);
+        const int samples = std::min(data->numSamples, LEGACY_BLOCK_SIZE);
+        SimulateCost();
+        memcpy(buffer + 2 * LEGACY_BLOCK_SIZE, buffer, samples * sizeof(float));
+        memcpy(buffer + 3 * LEGACY_BLOCK_SIZE, buffer + LEGACY_BLOCK_SIZE, samples * sizeof(float));
+        g_event_done.Set();
+    }
+
+    // 投入済みのスロットを seq の順にすべて処理する
+    void ProcessRing(RingHeader *ring, uint32_t &done_seq)
+    {
+        for (;;)
+        {
+            const uint32_t seq = done_seq + 1;
+            RingSlotHeader *slot = RingSlot(ring, seq);
+            if (std::atomic_ref<uint32_t>(slot->submitSeq).load(std::memory_order_acquire) != seq)
+                return;
+            SimulateCost();
+            const uint32_t channels = std::min<uint32_t>(slot->numChannels, ring->channelCount);
+            const size_t samples = std::min<size_t>(slot->numSamples, ring->blockSize);
+            for (uint32_t ch = 0; ch < channels; ++ch)
+                memcpy(RingSlotOutput(ring, slot, ch), RingSlotInput(ring, slot, ch), samples * sizeof(float));
+            std::atomic_ref<uint32_t>(slot->doneSeq).store(seq, std::memory_order_release);
+            done_seq = seq;
+            g_event_done.Set();
+        }
+    }
+
+    void AudioThread()
+    {
+        RingHeader *attached = nullptr;
+        uint32_t done_seq = 0;
+        while (!g_quit)
+        {
+            ipc_transport::WaitResult result = g_event_ready.Wait(100);
+            RingHeader *ring = g_ring.load(std::memory_order_acquire);
+            if (ring != attached)
+            {
+                attached = ring;
+                done_seq = 0;
+            }
+            if (ring)
+                ProcessRing(ring, done_seq);
+            else if (result == ipc_transport::WaitResult::signaled)
+                ProcessLegacy();
+        }
+    }
+
+    // 専用ホスト向けの形式 "<名前>" <スロット数> <ブロック長> <チャンネル数> だけを受け付ける。
+    // 処理中のリングを差し替えないよう、2回目以降は断る
+    bool AttachRing(const char *args)
+    {
+        const char *end = args[0] == '"' ? strchr(args + 1, '"') : nullptr;
+        if (!end)
+            return false;
+        const std::string name(args + 1, end);
+        char *next = nullptr;
+        const unsigned long slots = strtoul(end + 1, &next, 10);
+        const unsigned long block_size = strtoul(next, &next, 10);
+        const unsigned long channels = strtoul(next, &next, 10);
+        if (channels == 0 || g_ring.load() != nullptr || !g_ring_mapping.Open(name.c_str(), 0))
+            return false;
+        auto *ring = static_cast<RingHeader *>(g_ring_mapping.Data());
+        if (ring->version != RING_LAYOUT_VERSION || ring->slotCount != slots || ring->blockSize != block_size || ring->signalMode != ring_signal::event)
+        {
+            g_ring_mapping.Close();
+            return false;
+        }
+        g_ring.store(ring, std::memory_order_release);
+        return true;
+    }
+
+    void Reply(const std::string &text)
+    {
+        g_pipe.Write(text.c_str(), text.size());
+    }
+
+    void HandleCommand(const std::string &line)
+    {
+        const size_t space = line.find(' ');
+        const std::string command = line.substr(0, space);
+        const char *args = space == std::string::npos ? "" : line.c_str() + space + 1;
+        if (command == "get_capabilities")
+            Reply("OK ring latency offline state_serial automation tail\n");
+        else if (command == "init" || command == "load_plugin" || command == "set_offline" || command == "show_gui")
+            Reply("OK\n");
+        else if (command == "init_with_state" || command == "load_and_set_state")
+        {
+            const char *state = strrchr(args, ' ');
+            g_state = state ? state + 1 : DEFAULT_STATE_B64;
+            Reply("OK\n");
+        }
+        else if (command == "hide_gui")
+        {
+            // GUI での操作の代わりに、閉じるたびに状態が変わったことにする
+            if (RingHeader *ring = g_ring.load(std::memory_order_acquire))
+                std::atomic_ref<uint32_t>(ring->stateSerial).fetch_add(1, std::memory_order_release);
+            Reply("OK\n");
+        }
+        else if (command == "get_state")
+            Reply("OK " + g_state + "\n");
+        else if (command == "get_io_config")
+            Reply("OK 2 2\n");
+        else if (command == "get_latency")
+            Reply("OK " + std::to_string(g_options.latency) + "\n");
+        else if (command == "get_tail")
+            Reply("OK " + std::to_string(g_options.tail) + "\n");
+        else if (command == "attach_ring")
+            Reply(AttachRing(args) ? "OK\n" : "Error: cannot attach ring\n");
+        else if (command == "exit")
+        {
+            Reply("OK\n");
+            g_quit = true;
+        }
+        else
+            Reply("Error: unknown command " + command + "\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    LoadOptions(argc, argv);
+    if (!CreateIpc())
+        return 1;
+    if (!g_pipe.Accept())
+        return 1;
+    std::thread audio(AudioThread);
+
+    std::string pending;
+    char buffer[4096];
+    while (!g_quit)
+    {
+        size_t read = 0;
+        if (!g_pipe.ReadSome(buffer, sizeof(buffer), read) || read == 0)
+            break;
+        pending.append(buffer, read);
+        for (size_t newline; !g_quit && (newline = pending.find('\n')) != std::string::npos;)
+        {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            HandleCommand(line);
+        }
+    }
+    g_quit = true;
+    audio.join();
+    return 0;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// =================================================================
+// 共有メモリレイアウト（ホストプログラムと共通）
+// =================================================================
+#pragma pack(push, 1)
+struct AudioSharedData
+{
+    double sampleRate;
+    int32_t numSamples;
+    int32_t numChannels;
+};
+#pragma pack(pop)
+
+// get_capabilities の応答に含まれるトークンに対応するフラグ
+namespace host_caps
+{
+    enum flag : uint32_t
+    {
+        ring = 1u << 0,
+        spin = 1u << 1,
+        multi_instance = 1u << 2,
+        latency = 1u << 3,
+        offline = 1u << 4,
+        binary = 1u << 5,
+        state_serial = 1u << 6,
+        automation = 1u << 7,
+        chain = 1u << 8,
+        tail = 1u << 9,
+    };
+    struct token
+    {
+        const char *name;
+        uint32_t flag;
+    };
+    constexpr token tokens[] = {
+        {"ring", ring},
+        {"spin", spin},
+        {"multi_instance", multi_instance},
+        {"latency", latency},
+        {"offline", offline},
+        {"binary", binary},
+        {"state_serial", state_serial},
+        {"automation", automation},
+        {"chain", chain},
+        {"tail", tail},
+    };
+}
+
+// -----------------------------------------------------------------
+// リングバッファ転送 (host_caps::ring)
+// -----------------------------------------------------------------
+// [RingHeader][slot 0][slot 1]...[slot N-1]
+// slot: [RingSlotHeader][in 0]..[in C-1][out 0]..[out C-1][events]  (各 float[blockSize], C = channelCount)
+//
+// events は host_caps::automation 時だけ存在する AutomationEvent[eventCapacity] で、
+// 先頭から numEvents 個が sampleOffset の昇順に並びます。
+// submit_seq / done_seq は 1 から始まる通し番号で、ブロック seq は
+// slot[seq % slotCount] に置かれます。slotCount は 2 のべき乗です。
+// 各スロットでは先頭から numChannels 個のプレーンだけが有効です。
+constexpr uint32_t RING_LAYOUT_VERSION = 3;
+constexpr size_t RING_HEADER_SIZE = 64;
+constexpr uint32_t RING_MAX_CHANNELS = 8;
+
+struct RingHeader
+{
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t blockSize;
+    uint32_t slotStride;
+    uint32_t channelCount;
+    uint32_t signalMode;     // ring_signal::mode
+    uint32_t clientSleeping; // ring_signal::spin 時、クライアントがイベント待ちに入っている間 1
+    uint32_t hostSleeping;   // ring_signal::spin 時、ホストがイベント待ちに入っている間 1
+    uint32_t stateSerial;    // host_caps::state_serial 時、ホストがプラグインの状態を変えるたびに増やす
+    uint32_t eventCapacity;  // 各スロットに置けるオートメーションイベントの数。0 ならイベント領域なし
+};
+
+// blockSize はクライアントが attach_ring で指定します。1フレーム分 (frame_samples) が
+// 1ブロックに収まる 2 のべき乗を基準に、get_capabilities の max_block で制限します。
+constexpr int MIN_NEGOTIATED_BLOCK_SIZE = 64;
+constexpr int MAX_NEGOTIATED_BLOCK_SIZE = 16384;
+constexpr int NegotiateRingBlockSize(int frame_samples, uint32_t host_max_block_size)
+{
+    int block_size = MIN_NEGOTIATED_BLOCK_SIZE;
+    while (block_size < frame_samples && block_size < MAX_NEGOTIATED_BLOCK_SIZE)
+        block_size <<= 1;
+    if (host_max_block_size > 0)
+    {
+        int host_max = host_max_block_size > static_cast<uint32_t>(MIN_NEGOTIATED_BLOCK_SIZE) ? static_cast<int>(host_max_block_size) : MIN_NEGOTIATED_BLOCK_SIZE;
+        block_size = block_size < host_max ? block_size : host_max;
+    }
+    return block_size;
+}
+
+// ring_signal::spin では submitSeq / doneSeq を短時間スピンで待ち、相手の
+// *Sleeping が 1 の場合だけイベントをセットします（Spin_Signal.h）。
+namespace ring_signal
+{
+    enum mode : uint32_t
+    {
+        event = 0,
+        spin = 1,
+    };
+}
+
+struct alignas(64) RingSlotHeader
+{
+    uint32_t submitSeq; // クライアントが入力を書き終えた後に更新
+    uint32_t doneSeq;   // ホストが出力を書き終えた後に submitSeq と同じ値へ更新
+    double sampleRate;
+    int32_t numSamples;
+    int32_t numChannels;
+    uint32_t numEvents; // このブロックに適用するオートメーションイベントの数
+};
+
+// lane の値を、ブロックの先頭から sampleOffset サンプル目以降 value (0.0〜1.0) にする
+struct AutomationEvent
+{
+    uint32_t sampleOffset;
+    uint32_t lane;
+    float value;
+};
+
+constexpr size_t RingSlotStride(uint32_t block_size, uint32_t channel_count, uint32_t event_capacity = 0)
+{
+    size_t bytes = sizeof(RingSlotHeader) + 2 * static_cast<size_t>(channel_count) * block_size * sizeof(float) + static_cast<size_t>(event_capacity) * sizeof(AutomationEvent);
+    return (bytes + 63) & ~static_cast<size_t>(63);
+}
+constexpr size_t RingMappingSize(uint32_t slot_count, uint32_t block_size, uint32_t channel_count, uint32_t event_capacity = 0)
+{
+    return RING_HEADER_SIZE + static_cast<size_t>(slot_count) * RingSlotStride(block_size, channel_count, event_capacity);
+}
+inline RingSlotHeader *RingSlot(void *ring, uint32_t seq)
+{
+    auto *header = static_cast<RingHeader *>(ring);
+    return reinterpret_cast<RingSlotHeader *>(static_cast<char *>(ring) + RING_HEADER_SIZE + static_cast<size_t>(seq & (header->slotCount - 1)) * header->slotStride);
+}
+inline float *RingSlotInput(const RingHeader *header, RingSlotHeader *slot, uint32_t channel)
+{
+    return reinterpret_cast<float *>(slot + 1) + static_cast<size_t>(channel) * header->blockSize;
+}
+inline float *RingSlotOutput(const RingHeader *header, RingSlotHeader *slot, uint32_t channel)
+{
+    return reinterpret_cast<float *>(slot + 1) + static_cast<size_t>(header->channelCount + channel) * header->blockSize;
+}
+inline AutomationEvent *RingSlotEvents(const RingHeader *header, RingSlotHeader *slot)
+{
+    return reinterpret_cast<AutomationEvent *>(reinterpret_cast<float *>(slot + 1) + 2 * static_cast<size_t>(header->channelCount) * header->blockSize);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// =================================================================
+// スピン後にブロックする共有メモリ上の通知
+// =================================================================
+// 通知側は値を書き込んだ後、相手の sleeping フラグが立っている場合だけ
+// OS の起床処理 (イベント / futex) を呼びます。待機側は spin_us だけ値を
+// ポーリングし、それでも届かなければ sleeping を立ててから眠ります。
+// 両側とも seq_cst で書き込み→読み出しを行うため起床の取りこぼしはありません。
+namespace spin_signal
+{
+    inline void CpuRelax()
+    {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#endif
+    }
+
+    template <typename Wake>
+    void Publish(uint32_t &word, uint32_t value, uint32_t &peer_sleeping, Wake &&wake)
+    {
+        std::atomic_ref<uint32_t>(word).store(value, std::memory_order_seq_cst);
+        if (std::atomic_ref<uint32_t>(peer_sleeping).load(std::memory_order_seq_cst) != 0)
+            wake();
+    }
+
+    // block(observed, timeout_ms) は word が observed から変わるか timeout_ms 経過するまで眠る関数です。
+    // 偽の起床は許容されます。
+    template <typename Block>
+    bool WaitFor(uint32_t &word, uint32_t expected, uint32_t &self_sleeping, uint32_t spin_us, uint32_t timeout_ms, Block &&block)
+    {
+        using clock = std::chrono::steady_clock;
+        std::atomic_ref<uint32_t> value(word);
+        std::atomic_ref<uint32_t> sleeping(self_sleeping);
+        const auto start = clock::now();
+        const auto spin_end = start + std::chrono::microseconds(spin_us);
+        const auto deadline = start + std::chrono::milliseconds(timeout_ms);
+
+        while (value.load(std::memory_order_acquire) != expected)
+        {
+            if (clock::now() >= spin_end)
+            {
+                for (;;)
+                {
+                    auto now = clock::now();
+                    if (now >= deadline)
+                        return false;
+                    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+                    sleeping.store(1, std::memory_order_seq_cst);
+                    uint32_t observed = value.load(std::memory_order_seq_cst);
+                    if (observed == expected)
+                    {
+                        sleeping.store(0, std::memory_order_relaxed);
+                        return true;
+                    }
+                    block(observed, static_cast<uint32_t>(remaining));
+                    sleeping.store(0, std::memory_order_relaxed);
+                    if (value.load(std::memory_order_acquire) == expected)
+                        return true;
+                }
+            }
+            for (int i = 0; i < 64; ++i)
+                CpuRelax();
+        }
+        return true;
+    }
+
+#ifdef __linux__
+    // プロセス間で共有するため FUTEX_PRIVATE_FLAG は付けません
+    inline void FutexWait(uint32_t *word, uint32_t observed, uint32_t timeout_ms)
+    {
+        timespec timeout = {static_cast<time_t>(timeout_ms / 1000), static_cast<long>(timeout_ms % 1000) * 1000000L};
+        syscall(SYS_futex, word, FUTEX_WAIT, observed, &timeout, nullptr, 0);
+    }
+    inline void FutexWake(uint32_t *word)
+    {
+        syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+#endif
+}
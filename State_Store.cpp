@@ -0,0 +1,317 @@
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "State_Store.h"
+#include <bcrypt.h>
+#include <compressapi.h>
+#include <cstring>
+#include <mutex>
+#include <tchar.h>
+#include <unordered_map>
+
+namespace state_store
+{
+    namespace
+    {
+        constexpr uint32_t FILE_MAGIC = 0x53535041; // "APSS"
+        constexpr uint32_t FILE_VERSION = 1;
+        constexpr uint64_t MAX_RAW_SIZE = 256ull * 1024 * 1024;
+
+#pragma pack(push, 1)
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t raw_size;
+        };
+#pragma pack(pop)
+
+        std::mutex g_mutex;
+        TCHAR g_directory[MAX_PATH] = {0};
+
+        // このプロセスで Put したキーごとの、まだ Discard されていない数と、ファイルを新しく作ったか
+        struct SessionEntry
+        {
+            int references = 0;
+            bool created = false;
+        };
+        std::unordered_map<std::string, SessionEntry> g_session;
+
+        bool Sha256Hex(const uint8_t *data, size_t size, std::string &hex)
+        {
+            BCRYPT_ALG_HANDLE algorithm = NULL;
+            if (BCryptOpenAlgorithmProvider(&algorithm, BCRYPT_SHA256_ALGORITHM, NULL, 0) != 0)
+                return false;
+            uint8_t digest[32];
+            BCRYPT_HASH_HANDLE hash = NULL;
+            bool ok = BCryptCreateHash(algorithm, &hash, NULL, 0, NULL, 0, 0) == 0 &&
+                      BCryptHashData(hash, const_cast<PUCHAR>(data), static_cast<ULONG>(size), 0) == 0 &&
+                      BCryptFinishHash(hash, digest, sizeof(digest), 0) == 0;
+            if (hash)
+                BCryptDestroyHash(hash);
+            BCryptCloseAlgorithmProvider(algorithm, 0);
+            if (!ok)
+                return false;
+            static const char digits[] = "0123456789abcdef";
+            hex.resize(HASH_HEX_LENGTH);
+            for (size_t i = 0; i < sizeof(digest); ++i)
+            {
+                hex[i * 2] = digits[digest[i] >> 4];
+                hex[i * 2 + 1] = digits[digest[i] & 15];
+            }
+            return true;
+        }
+
+        bool IsValidHash(const std::string &hash)
+        {
+            if (hash.size() != HASH_HEX_LENGTH)
+                return false;
+            for (char c : hash)
+            {
+                if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+                    return false;
+            }
+            return true;
+        }
+
+        void BlobPath(const std::string &hash, TCHAR *path)
+        {
+            _stprintf_s(path, MAX_PATH, _T("%s\\%hs.bin"), g_directory, hash.c_str());
+        }
+
+        void PinPath(const std::string &hash, TCHAR *path)
+        {
+            _stprintf_s(path, MAX_PATH, _T("%s\\%hs.pin"), g_directory, hash.c_str());
+        }
+
+        // 最終更新日時を「最後に使った日時」として Sweep で使う
+        void Touch(const TCHAR *path)
+        {
+            HANDLE file = CreateFile(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+            FILETIME now;
+            GetSystemTimeAsFileTime(&now);
+            SetFileTime(file, NULL, NULL, &now);
+            CloseHandle(file);
+        }
+
+        uint64_t FileTimeToU64(const FILETIME &time)
+        {
+            return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        }
+    }
+
+    void SetDirectory(const TCHAR *directory)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        _tcscpy_s(g_directory, directory);
+        CreateDirectory(g_directory, NULL);
+    }
+
+    std::string Put(const uint8_t *raw, size_t size)
+    {
+        std::string hash;
+        if (size == 0 || size > MAX_RAW_SIZE || !Sha256Hex(raw, size, hash))
+            return {};
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_directory[0] == _T('\0'))
+            return {};
+        TCHAR path[MAX_PATH];
+        BlobPath(hash, path);
+        if (GetFileAttributes(path) != INVALID_FILE_ATTRIBUTES)
+        {
+            Touch(path);
+            g_session[hash].references++;
+            return hash;
+        }
+
+        COMPRESSOR_HANDLE compressor = NULL;
+        if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &compressor))
+            return {};
+        SIZE_T needed = 0;
+        Compress(compressor, raw, size, NULL, 0, &needed);
+        std::vector<uint8_t> blob(sizeof(FileHeader) + needed);
+        SIZE_T compressed = 0;
+        bool ok = Compress(compressor, raw, size, blob.data() + sizeof(FileHeader), needed, &compressed) != FALSE;
+        CloseCompressor(compressor);
+        if (!ok)
+            return {};
+        FileHeader header = {FILE_MAGIC, FILE_VERSION, size};
+        memcpy(blob.data(), &header, sizeof(header));
+        blob.resize(sizeof(FileHeader) + compressed);
+
+        // 書き込み途中のファイルを読まれないよう、一時ファイルに書いてから名前を変える
+        TCHAR temp_path[MAX_PATH];
+        _stprintf_s(temp_path, _T("%s.%lu.tmp"), path, GetCurrentProcessId());
+        HANDLE file = CreateFile(temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return {};
+        DWORD written = 0;
+        ok = WriteFile(file, blob.data(), static_cast<DWORD>(blob.size()), &written, NULL) && written == blob.size();
+        CloseHandle(file);
+        if (!ok || !MoveFileEx(temp_path, path, MOVEFILE_REPLACE_EXISTING))
+        {
+            DeleteFile(temp_path);
+            return {};
+        }
+        SessionEntry &entry = g_session[hash];
+        entry.references++;
+        entry.created = true;
+        return hash;
+    }
+
+    bool Get(const std::string &hash, std::vector<uint8_t> &raw)
+    {
+        if (!IsValidHash(hash))
+            return false;
+        TCHAR path[MAX_PATH];
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            if (g_directory[0] == _T('\0'))
+                return false;
+            BlobPath(hash, path);
+        }
+        HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size = {};
+        std::vector<uint8_t> blob;
+        bool ok = GetFileSizeEx(file, &file_size) && file_size.QuadPart >= static_cast<LONGLONG>(sizeof(FileHeader)) &&
+                  file_size.QuadPart <= static_cast<LONGLONG>(MAX_RAW_SIZE);
+        if (ok)
+        {
+            blob.resize(static_cast<size_t>(file_size.QuadPart));
+            DWORD read = 0;
+            ok = ReadFile(file, blob.data(), static_cast<DWORD>(blob.size()), &read, NULL) && read == blob.size();
+        }
+        CloseHandle(file);
+        if (!ok)
+            return false;
+
+        FileHeader header;
+        memcpy(&header, blob.data(), sizeof(header));
+        if (header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.raw_size > MAX_RAW_SIZE)
+            return false;
+        DECOMPRESSOR_HANDLE decompressor = NULL;
+        if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, NULL, &decompressor))
+            return false;
+        raw.resize(static_cast<size_t>(header.raw_size));
+        SIZE_T decompressed = 0;
+        ok = Decompress(decompressor, blob.data() + sizeof(FileHeader), blob.size() - sizeof(FileHeader), raw.data(), raw.size(), &decompressed) &&
+             decompressed == raw.size();
+        CloseDecompressor(decompressor);
+        if (!ok)
+            return false;
+
+        // 破損したファイルを別の状態として使わないよう、内容とキーを照合する
+        std::string actual;
+        if (!Sha256Hex(raw.data(), raw.size(), actual) || actual != hash)
+            return false;
+        Touch(path);
+        return true;
+    }
+
+    void Discard(const std::string &hash)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_session.find(hash);
+        if (it == g_session.end() || --it->second.references > 0)
+            return;
+        const bool created = it->second.created;
+        g_session.erase(it);
+        // 以前からあったファイルは他のプロジェクトが参照しているかもしれない
+        if (!created || g_directory[0] == _T('\0'))
+            return;
+        TCHAR path[MAX_PATH];
+        PinPath(hash, path);
+        if (GetFileAttributes(path) != INVALID_FILE_ATTRIBUTES)
+            return;
+        BlobPath(hash, path);
+        DeleteFile(path);
+    }
+
+    void Pin(const std::string &hash)
+    {
+        if (!IsValidHash(hash))
+            return;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_directory[0] == _T('\0'))
+            return;
+        TCHAR path[MAX_PATH];
+        PinPath(hash, path);
+        HANDLE file = CreateFile(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+    }
+
+    void Unpin(const std::string &hash)
+    {
+        if (!IsValidHash(hash))
+            return;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_directory[0] == _T('\0'))
+            return;
+        TCHAR path[MAX_PATH];
+        PinPath(hash, path);
+        if (!DeleteFile(path))
+            return;
+        // 期限は Pin を外した時点から数える
+        BlobPath(hash, path);
+        Touch(path);
+    }
+
+    int Sweep(int retention_days)
+    {
+        if (retention_days <= 0)
+            return 0;
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_directory[0] == _T('\0'))
+            return 0;
+        FILETIME now_time;
+        GetSystemTimeAsFileTime(&now_time);
+        const uint64_t retention = static_cast<uint64_t>(retention_days) * 24 * 60 * 60 * 10000000ull;
+        const uint64_t now = FileTimeToU64(now_time);
+        if (now < retention)
+            return 0;
+        const uint64_t cutoff = now - retention;
+
+        TCHAR pattern[MAX_PATH];
+        _stprintf_s(pattern, _T("%s\\*"), g_directory);
+        WIN32_FIND_DATA found;
+        HANDLE find = FindFirstFile(pattern, &found);
+        if (find == INVALID_HANDLE_VALUE)
+            return 0;
+        int deleted = 0;
+        do
+        {
+            if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || FileTimeToU64(found.ftLastWriteTime) >= cutoff)
+                continue;
+            const TCHAR *extension = _tcsrchr(found.cFileName, _T('.'));
+            if (!extension)
+                continue;
+            TCHAR path[MAX_PATH];
+            _stprintf_s(path, _T("%s\\%s"), g_directory, found.cFileName);
+            // 書き込みに失敗して残った一時ファイル
+            if (_tcsicmp(extension, _T(".tmp")) == 0)
+            {
+                deleted += DeleteFile(path) ? 1 : 0;
+                continue;
+            }
+            if (_tcsicmp(extension, _T(".bin")) != 0)
+                continue;
+            // 16進数以外の文字が含まれていれば IsValidHash で除外される
+            std::string hash;
+            for (const TCHAR *c = found.cFileName; c < extension; ++c)
+                hash.push_back(static_cast<char>(*c));
+            if (!IsValidHash(hash) || g_session.count(hash) > 0)
+                continue;
+            PinPath(hash, path);
+            if (GetFileAttributes(path) != INVALID_FILE_ATTRIBUTES)
+                continue;
+            BlobPath(hash, path);
+            deleted += DeleteFile(path) ? 1 : 0;
+        } while (FindNextFile(find, &found));
+        FindClose(find);
+        return deleted;
+    }
+}
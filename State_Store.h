@@ -0,0 +1,38 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =================================================================
+// プラグイン状態の保存領域
+// =================================================================
+// 状態の生データを SHA-256 をキーに圧縮して1ファイルずつ保存します。
+// 同じ内容の状態 (同じプリセットなど) は1つのファイルを共有します。
+//
+// どのプロジェクトがどのファイルを参照しているかは分からないため、次の規則で削除します。
+//   - このプロセスが作ったファイルで、Put で渡したキーがすべて Discard されたものは即座に消す
+//     (exdata に書き込まれる前に新しい状態で置き換えられたもの)
+//   - Pin したファイル (exdata に複製が収まらず、これが唯一の保存先になったもの) は Unpin されるまで消さない
+//     (Pin は GUI を閉じたときなど、ユーザーが確定させた状態だけに行い、新しい状態で置き換えたら Unpin する)
+//   - それ以外は最後に読み書きしてから retention_days 日を過ぎたら Sweep で消す
+//     (exdata に複製があるか、どの exdata にも書き込まれなかったもの)
+namespace state_store
+{
+    constexpr size_t HASH_HEX_LENGTH = 64;
+
+    void SetDirectory(const TCHAR *directory);
+
+    // 保存したキー (16進数の SHA-256) を返します。失敗した場合は空文字列です
+    std::string Put(const uint8_t *raw, size_t size);
+    bool Get(const std::string &hash, std::vector<uint8_t> &raw);
+
+    // Put で得たキーを使わなくなったときに呼びます
+    void Discard(const std::string &hash);
+    // exdata がこのファイルだけを頼りにするようになったときに呼びます
+    void Pin(const std::string &hash);
+    // Pin したファイルを使わなくなったときに呼びます。以降は Sweep の期限に従って消えます
+    void Unpin(const std::string &hash);
+    // 期限を過ぎたファイルを消し、消した数を返します。retention_days が 0 なら何もしません
+    int Sweep(int retention_days);
+}
@@ -0,0 +1,96 @@
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "Stats_Page.h"
+#include <cstring>
+
+namespace stats_page
+{
+    void RecordRoundTrip(ObjectStats &stats, uint64_t us)
+    {
+        size_t bucket = 0;
+        while (bucket < std::size(ROUND_TRIP_BOUNDS_US) && us >= ROUND_TRIP_BOUNDS_US[bucket])
+            ++bucket;
+        Add(stats.roundTripHistogram[bucket], 1);
+        Add(stats.roundTripUs, us);
+    }
+
+    uint64_t NowUs()
+    {
+        static const uint64_t frequency = []
+        {
+            LARGE_INTEGER f;
+            QueryPerformanceFrequency(&f);
+            return static_cast<uint64_t>(f.QuadPart);
+        }();
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return static_cast<uint64_t>(now.QuadPart) / frequency * 1000000 + static_cast<uint64_t>(now.QuadPart) % frequency * 1000000 / frequency;
+    }
+
+    Publisher::~Publisher()
+    {
+        Close();
+    }
+
+    bool Publisher::Open()
+    {
+        if (page)
+            return true;
+        TCHAR name[MAX_PATH];
+        _stprintf_s(name, _T("%s_%lu"), NAME_BASE, GetCurrentProcessId());
+        mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(PAGE_SIZE), name);
+        if (!mapping)
+            return false;
+        page = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, PAGE_SIZE);
+        if (!page)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+            return false;
+        }
+        auto *header = static_cast<PageHeader *>(page);
+        header->version = VERSION;
+        header->slotCount = SLOT_COUNT;
+        header->slotSize = sizeof(ObjectStats);
+        std::atomic_ref<uint32_t>(header->magic).store(MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    void Publisher::Close()
+    {
+        if (page)
+            UnmapViewOfFile(page);
+        if (mapping)
+            CloseHandle(mapping);
+        page = nullptr;
+        mapping = NULL;
+    }
+
+    ObjectStats *Publisher::Acquire(uint32_t object_id, const char *plugin_name)
+    {
+        if (!page)
+            return &overflow;
+        ObjectStats *slots = Slots(page);
+        for (uint32_t i = 0; i < SLOT_COUNT; ++i)
+        {
+            uint32_t expected = 0;
+            if (!std::atomic_ref<uint32_t>(slots[i].inUse).compare_exchange_strong(expected, 2))
+                continue;
+            // 2 の間は読み出し側から無視される
+            ObjectStats &stats = slots[i];
+            memset(reinterpret_cast<char *>(&stats) + sizeof(stats.inUse), 0, sizeof(stats) - sizeof(stats.inUse));
+            stats.objectId = object_id;
+            strncpy_s(stats.pluginName, plugin_name, _TRUNCATE);
+            std::atomic_ref<uint32_t>(stats.inUse).store(1, std::memory_order_release);
+            return &stats;
+        }
+        return &overflow;
+    }
+
+    void Publisher::Release(ObjectStats *stats)
+    {
+        if (!stats || stats == &overflow)
+            return;
+        std::atomic_ref<uint32_t>(stats->inUse).store(0, std::memory_order_release);
+    }
+}
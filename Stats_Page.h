@@ -0,0 +1,103 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tchar.h>
+
+// =================================================================
+// オブジェクトごとの統計ページ
+// =================================================================
+// 名前付き共有メモリ "<NAME_BASE>_<AviUtl のプロセスID>" に、
+// HostState ごとのカウンタを並べて公開します。書き込み側はロックを取らず
+// atomic に加算するだけなので、Stats_Reader から実行中にいつでも読めます。
+namespace stats_page
+{
+    constexpr TCHAR NAME_BASE[] = _T("AudioPluginHost_Stats");
+    constexpr uint32_t MAGIC = 0x53504841; // "AHPS"
+    constexpr uint32_t VERSION = 5;
+    constexpr uint32_t SLOT_COUNT = 256;
+    constexpr size_t PLUGIN_NAME_SIZE = 64;
+
+    // 往復時間のヒストグラムの境界 (マイクロ秒)。最後のバケットはそれ以上
+    constexpr uint32_t ROUND_TRIP_BOUNDS_US[] = {250, 500, 1000, 2000, 5000, 10000, 50000};
+    constexpr size_t ROUND_TRIP_BUCKETS = std::size(ROUND_TRIP_BOUNDS_US) + 1;
+
+    struct PageHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t slotSize;
+    };
+
+    // inUse が 1 のスロットだけが有効です (2 は初期化中)。カウンタはオブジェクトの作成からの累計です
+    struct alignas(64) ObjectStats
+    {
+        uint32_t inUse;
+        uint32_t objectId;
+        char pluginName[PLUGIN_NAME_SIZE]; // プラグインのファイル名
+        uint64_t frames;
+        uint64_t blocks;
+        uint64_t roundTripUs;
+        uint64_t roundTripHistogram[ROUND_TRIP_BUCKETS];
+        uint64_t convertUs;
+        uint64_t timeouts;           // 待ちきれずに未処理の音声を出力したフレーム
+        uint64_t bypassFrames;       // ホストが使えず未処理のまま出力したフレーム (退避から戻す間は restoreBypassFrames)
+        uint64_t budgetBypassFrames; // フレームの予算に収まらない見込みで未処理のまま出力したフレーム
+        uint64_t silentBlocks;       // 入力が無音で余韻も終わっていたため、ホストに送らずに無音を出力したブロック
+        uint64_t restarts;
+        uint64_t launchMs;            // 直近の起動要求から ready までの時間
+        uint64_t evictions;           // アイドル状態のためホストを終了させた回数
+        uint64_t evictMs;             // 退避 (状態の取得とホストの解放) にかかった時間の合計
+        uint64_t restores;            // 退避後に再び処理されて起動し直した回数
+        uint64_t restoreMs;           // その起動要求から ready までの時間の合計
+        uint64_t restoreBypassFrames; // 退避したホストを起動し直している間に未処理のまま出力したフレーム
+        uint64_t bytesToHost;
+        uint64_t bytesFromHost;
+    };
+
+    constexpr size_t SLOTS_OFFSET = 64;
+    static_assert(sizeof(PageHeader) <= SLOTS_OFFSET);
+    constexpr size_t PAGE_SIZE = SLOTS_OFFSET + SLOT_COUNT * sizeof(ObjectStats);
+
+    inline ObjectStats *Slots(void *page)
+    {
+        return reinterpret_cast<ObjectStats *>(static_cast<char *>(page) + SLOTS_OFFSET);
+    }
+
+    inline void Add(uint64_t &counter, uint64_t value)
+    {
+        std::atomic_ref<uint64_t>(counter).fetch_add(value, std::memory_order_relaxed);
+    }
+    inline void Set(uint64_t &counter, uint64_t value)
+    {
+        std::atomic_ref<uint64_t>(counter).store(value, std::memory_order_relaxed);
+    }
+    inline uint64_t Load(const uint64_t &counter)
+    {
+        return std::atomic_ref<uint64_t>(const_cast<uint64_t &>(counter)).load(std::memory_order_relaxed);
+    }
+    void RecordRoundTrip(ObjectStats &stats, uint64_t us);
+
+    // QueryPerformanceCounter によるマイクロ秒単位の時刻
+    uint64_t NowUs();
+
+    class Publisher
+    {
+    public:
+        ~Publisher();
+        bool Open();
+        void Close();
+
+        // 空きスロットがない場合や Open に失敗した場合も、書き込み先として有効な領域を返します
+        ObjectStats *Acquire(uint32_t object_id, const char *plugin_name);
+        void Release(ObjectStats *stats);
+
+    private:
+        HANDLE mapping = NULL;
+        void *page = nullptr;
+        ObjectStats overflow = {};
+    };
+}
@@ -0,0 +1,132 @@
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include "Stats_Page.h"
+#include <TlHelp32.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// =================================================================
+// 統計ページの表示
+// =================================================================
+// 使い方: Stats_Reader [AviUtl のプロセスID] [-w]
+// プロセスIDを省略すると実行中の aviutl.exe を探します。-w を付けると1秒ごとに更新します。
+namespace
+{
+    DWORD FindAviUtlProcess()
+    {
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot == INVALID_HANDLE_VALUE)
+            return 0;
+        PROCESSENTRY32 entry = {};
+        entry.dwSize = sizeof(entry);
+        DWORD pid = 0;
+        for (BOOL ok = Process32First(snapshot, &entry); ok; ok = Process32Next(snapshot, &entry))
+        {
+            if (_tcsicmp(entry.szExeFile, _T("aviutl.exe")) == 0)
+            {
+                pid = entry.th32ProcessID;
+                break;
+            }
+        }
+        CloseHandle(snapshot);
+        return pid;
+    }
+
+    void PrintPage(void *page)
+    {
+        printf("%6s %-24s %9s %9s %9s %9s %8s %8s %8s %8s %8s %6s %6s %8s %7s %8s %7s %8s %10s\n",
+               "object", "plugin", "frames", "blocks", "rt avg us", "cvt us/b", "timeout", "bypass", "budget", "silent", "restart", "launch",
+               "evict", "ev ms", "restore", "rs ms", "rs dry", "MB in", "MB out");
+        const stats_page::ObjectStats *slots = stats_page::Slots(page);
+        uint64_t histogram[stats_page::ROUND_TRIP_BUCKETS] = {};
+        for (uint32_t i = 0; i < stats_page::SLOT_COUNT; ++i)
+        {
+            const auto &stats = slots[i];
+            if (std::atomic_ref<uint32_t>(const_cast<uint32_t &>(stats.inUse)).load(std::memory_order_acquire) != 1)
+                continue;
+            const uint64_t blocks = stats_page::Load(stats.blocks);
+            const uint64_t divisor = blocks > 0 ? blocks : 1;
+            const uint64_t evictions = stats_page::Load(stats.evictions);
+            const uint64_t restores = stats_page::Load(stats.restores);
+            printf("%6u %-24.24s %9llu %9llu %9llu %9llu %8llu %8llu %8llu %8llu %8llu %6llu %6llu %8llu %7llu %8llu %7llu %8.1f %10.1f\n",
+                   stats.objectId, stats.pluginName,
+                   stats_page::Load(stats.frames), blocks,
+                   stats_page::Load(stats.roundTripUs) / divisor, stats_page::Load(stats.convertUs) / divisor,
+                   stats_page::Load(stats.timeouts), stats_page::Load(stats.bypassFrames), stats_page::Load(stats.budgetBypassFrames), stats_page::Load(stats.silentBlocks),
+                   stats_page::Load(stats.restarts),
+                   stats_page::Load(stats.launchMs),
+                   evictions, stats_page::Load(stats.evictMs) / (evictions > 0 ? evictions : 1),
+                   restores, stats_page::Load(stats.restoreMs) / (restores > 0 ? restores : 1), stats_page::Load(stats.restoreBypassFrames),
+                   stats_page::Load(stats.bytesToHost) / 1048576.0, stats_page::Load(stats.bytesFromHost) / 1048576.0);
+            for (size_t b = 0; b < stats_page::ROUND_TRIP_BUCKETS; ++b)
+                histogram[b] += stats_page::Load(stats.roundTripHistogram[b]);
+        }
+        printf("round trip (all objects):");
+        for (size_t b = 0; b < stats_page::ROUND_TRIP_BUCKETS; ++b)
+        {
+            if (b < std::size(stats_page::ROUND_TRIP_BOUNDS_US))
+                printf(" <%uus:%llu", stats_page::ROUND_TRIP_BOUNDS_US[b], histogram[b]);
+            else
+                printf(" >=%uus:%llu", stats_page::ROUND_TRIP_BOUNDS_US[b - 1], histogram[b]);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    DWORD pid = 0;
+    bool watch = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-w") == 0)
+            watch = true;
+        else
+            pid = strtoul(argv[i], nullptr, 10);
+    }
+    if (pid == 0)
+        pid = FindAviUtlProcess();
+    if (pid == 0)
+    {
+        fprintf(stderr, "aviutl.exe is not running. Pass the process ID explicitly.\n");
+        return 1;
+    }
+
+    TCHAR name[MAX_PATH];
+    _stprintf_s(name, _T("%s_%lu"), stats_page::NAME_BASE, pid);
+    HANDLE mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name);
+    if (!mapping)
+    {
+        fprintf(stderr, "No stats page for process %lu (error %lu).\n", pid, GetLastError());
+        return 1;
+    }
+    void *page = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, stats_page::PAGE_SIZE);
+    if (!page)
+    {
+        fprintf(stderr, "MapViewOfFile failed: %lu\n", GetLastError());
+        CloseHandle(mapping);
+        return 1;
+    }
+    const auto *header = static_cast<const stats_page::PageHeader *>(page);
+    if (header->magic != stats_page::MAGIC || header->version != stats_page::VERSION || header->slotSize != sizeof(stats_page::ObjectStats))
+    {
+        fprintf(stderr, "Unsupported stats page layout (version %u).\n", header->version);
+        UnmapViewOfFile(page);
+        CloseHandle(mapping);
+        return 1;
+    }
+
+    for (;;)
+    {
+        if (watch)
+            system("cls");
+        PrintPage(page);
+        if (!watch)
+            break;
+        Sleep(1000);
+    }
+    UnmapViewOfFile(page);
+    CloseHandle(mapping);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <inttypes.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace
+{
+    namespace
+    {
+        struct Event
+        {
+            const char *name;
+            uint64_t begin_us;
+            uint64_t duration_us;
+            int64_t arg;
+        };
+
+        // 書き込むのは所有スレッドだけで、count を release で進めてから読み出し側に見せる
+        struct ThreadBuffer
+        {
+            uint32_t tid = 0;
+            std::atomic<const char *> name = nullptr;
+            std::atomic<uint32_t> count = 0;
+            std::atomic<uint64_t> dropped = 0;
+            std::unique_ptr<Event[]> events;
+        };
+
+        std::atomic<bool> g_enabled = false;
+        std::atomic<uint64_t> g_dropped = 0;
+        const auto g_epoch = std::chrono::steady_clock::now();
+        // スレッドの終了後も書き出せるよう、バッファはプロセスの終了まで保持する
+        std::mutex g_buffers_mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+
+        ThreadBuffer &LocalBuffer()
+        {
+            thread_local ThreadBuffer *buffer = nullptr;
+            if (!buffer)
+            {
+                auto owned = std::make_unique<ThreadBuffer>();
+                owned->events = std::make_unique<Event[]>(EVENTS_PER_THREAD);
+                std::lock_guard<std::mutex> lock(g_buffers_mutex);
+                owned->tid = static_cast<uint32_t>(g_buffers.size()) + 1;
+                buffer = owned.get();
+                g_buffers.push_back(std::move(owned));
+            }
+            return *buffer;
+        }
+
+        void WriteString(std::FILE *out, const char *text)
+        {
+            std::fputc('"', out);
+            for (; *text; ++text)
+            {
+                if (*text == '"' || *text == '\\')
+                    std::fputc('\\', out);
+                if (static_cast<unsigned char>(*text) >= 0x20)
+                    std::fputc(*text, out);
+            }
+            std::fputc('"', out);
+        }
+    }
+
+    void Enable()
+    {
+        g_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    bool Enabled()
+    {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t NowUs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_epoch).count());
+    }
+
+    void Record(const char *name, uint64_t begin_us, uint64_t duration_us, int64_t arg)
+    {
+        ThreadBuffer &buffer = LocalBuffer();
+        uint32_t index = buffer.count.load(std::memory_order_relaxed);
+        if (index >= EVENTS_PER_THREAD)
+        {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[index] = {name, begin_us, duration_us, arg};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void SetThreadName(const char *name)
+    {
+        if (Enabled())
+            LocalBuffer().name.store(name, std::memory_order_release);
+    }
+
+    bool WriteChromeTrace(std::FILE *out)
+    {
+        std::lock_guard<std::mutex> lock(g_buffers_mutex);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+        bool first = true;
+        auto separator = [&]
+        {
+            std::fputs(first ? "\n" : ",\n", out);
+            first = false;
+        };
+        for (const auto &buffer : g_buffers)
+        {
+            if (const char *name = buffer->name.load(std::memory_order_acquire))
+            {
+                separator();
+                std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":", buffer->tid);
+                WriteString(out, name);
+                std::fputs("}}", out);
+            }
+            const uint32_t count = buffer->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const Event &event = buffer->events[i];
+                separator();
+                std::fputs("{\"name\":", out);
+                WriteString(out, event.name);
+                std::fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64,
+                             buffer->tid, event.begin_us, event.duration_us);
+                if (event.arg != NO_ARG)
+                    std::fprintf(out, ",\"args\":{\"value\":%" PRId64 "}", event.arg);
+                std::fputc('}', out);
+            }
+            // 捨てたイベントは最後に確定したイベントの終わりに印を付けて、どこから欠けているか分かるようにする
+            if (const uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed))
+            {
+                const uint64_t ts = count > 0 ? buffer->events[count - 1].begin_us + buffer->events[count - 1].duration_us : 0;
+                separator();
+                std::fprintf(out, "{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%" PRIu64 ",\"args\":{\"count\":%" PRIu64 "}}",
+                             buffer->tid, ts, dropped);
+            }
+        }
+        std::fprintf(out, "\n],\"otherData\":{\"dropped_events\":%" PRIu64 "}}\n", Dropped());
+        return std::ferror(out) == 0;
+    }
+
+    uint64_t Dropped()
+    {
+        return g_dropped.load(std::memory_order_relaxed);
+    }
+}
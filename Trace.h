@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+// =================================================================
+// イベントトレース
+// =================================================================
+// TRACE_SPAN で囲んだ区間をスレッドごとのバッファに記録し、Chrome の
+// トレースイベント形式 (chrome://tracing, Perfetto) の JSON として書き出します。
+// 記録は Enable() を呼ぶまで行われず、無効時のコストは atomic の読み出し1回です。
+// EXTERNAL_AUDIO_DISABLE_TRACE を定義するとマクロごと取り除かれます。
+// Windows に依存しないため、ホストプログラムでもそのまま使えます。
+namespace trace
+{
+    // 各スレッドが記録できるイベント数。溢れた分は捨ててスレッドごとに数え、
+    // 書き出すトレースにも dropped_events として残す
+    constexpr uint32_t EVENTS_PER_THREAD = 1u << 16;
+
+    void Enable();
+    bool Enabled();
+    uint64_t NowUs();
+
+    // name は文字列リテラルなど、書き出しまで有効なものを渡してください
+    void Record(const char *name, uint64_t begin_us, uint64_t duration_us, int64_t arg);
+    void SetThreadName(const char *name);
+
+    // 記録中のスレッドがあっても安全に呼べます (その時点で確定したイベントだけが書き出されます)
+    bool WriteChromeTrace(std::FILE *out);
+    uint64_t Dropped();
+
+    constexpr int64_t NO_ARG = INT64_MIN;
+
+    class Span
+    {
+    public:
+        explicit Span(const char *name, int64_t arg = NO_ARG)
+            : name(Enabled() ? name : nullptr), arg(arg), begin_us(this->name ? NowUs() : 0)
+        {
+        }
+        ~Span()
+        {
+            if (name)
+                Record(name, begin_us, NowUs() - begin_us, arg);
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *name;
+        int64_t arg;
+        uint64_t begin_us;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef EXTERNAL_AUDIO_DISABLE_TRACE
+#define TRACE_SPAN(...) ((void)0)
+#else
+#define TRACE_SPAN(...) trace::Span TRACE_CONCAT(trace_span_, __COUNTER__)(__VA_ARGS__)
+#endif
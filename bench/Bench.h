@@ -0,0 +1,34 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// =================================================================
+// ベンチマーク共通
+// =================================================================
+namespace bench
+{
+    inline uint64_t NowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    // samples は並べ替えられます
+    inline uint64_t Percentile(std::vector<uint64_t> &samples, double p)
+    {
+        if (samples.empty())
+            return 0;
+        size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    void RunConvert();
+    void RunRoundTrips();
+    void RunProtocol();
+    void RunPingPong();
+    void RunMockHost();
+}
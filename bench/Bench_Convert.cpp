@@ -0,0 +1,48 @@
+#include "Bench.h"
+#include "Audio_Convert.h"
+#include <cstdio>
+#include <vector>
+
+// ISA ごとの変換スループット (1601 フレーム = 48kHz / 29.97fps の1フレーム分を繰り返す)
+namespace bench
+{
+    namespace
+    {
+        constexpr int FRAMES = 1601;
+        constexpr int ITERATIONS = 20000;
+        const char *const ISA_NAMES[] = {"scalar", "sse2", "avx2"};
+
+        template <class Fn>
+        void Measure(const char *isa_name, const char *kernel, Fn &&fn)
+        {
+            fn();
+            uint64_t start = NowNs();
+            for (int i = 0; i < ITERATIONS; ++i)
+                fn();
+            double seconds = static_cast<double>(NowNs() - start) / 1e9;
+            double msamples = static_cast<double>(FRAMES) * ITERATIONS / seconds / 1e6;
+            printf("  %-7s %-20s %9.1f Mframes/s\n", isa_name, kernel, msamples);
+        }
+    }
+
+    void RunConvert()
+    {
+        std::vector<int16_t> shorts(FRAMES * 2);
+        for (size_t i = 0; i < shorts.size(); ++i)
+            shorts[i] = static_cast<int16_t>((i * 7919) & 0xffff);
+        std::vector<float> left(FRAMES), right(FRAMES);
+        std::vector<int16_t> out(FRAMES * 2);
+
+        for (int isa = 0; isa < 3; ++isa)
+        {
+            if (!audio_convert::SelectIsa(static_cast<audio_convert::Isa>(isa)))
+                continue;
+            const char *name = ISA_NAMES[isa];
+            Measure(name, "ShortToFloatMono", [&] { audio_convert::ShortToFloatMono(shorts.data(), left.data(), FRAMES); });
+            Measure(name, "ShortToFloatStereo", [&] { audio_convert::ShortToFloatStereo(shorts.data(), left.data(), right.data(), FRAMES); });
+            Measure(name, "FloatToShortMono", [&] { audio_convert::FloatToShortMono(left.data(), out.data(), FRAMES); });
+            Measure(name, "FloatToShortStereo", [&] { audio_convert::FloatToShortStereo(left.data(), right.data(), out.data(), FRAMES); });
+            Measure(name, "FloatToShortDownmix", [&] { audio_convert::FloatToShortDownmix(left.data(), right.data(), out.data(), FRAMES); });
+        }
+    }
+}
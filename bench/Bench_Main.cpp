@@ -0,0 +1,53 @@
+#include "Bench.h"
+#include <cstdio>
+#include <cstring>
+
+// =================================================================
+// ベンチマークのエントリポイント
+// =================================================================
+// 使い方: bench [スイート名...]  (省略時はすべて実行)
+namespace
+{
+    struct Suite
+    {
+        const char *name;
+        void (*run)();
+    };
+
+    const Suite SUITES[] = {
+        {"convert", bench::RunConvert},
+        {"roundtrips", bench::RunRoundTrips},
+        {"protocol", bench::RunProtocol},
+#ifdef BENCH_PING_PONG
+        {"pingpong", bench::RunPingPong},
+#endif
+#ifdef BENCH_MOCK_HOST_PATH
+        {"mock", bench::RunMockHost},
+#endif
+    };
+}
+
+int main(int argc, char **argv)
+{
+    int ran = 0;
+    for (const Suite &suite : SUITES)
+    {
+        bool selected = argc <= 1;
+        for (int i = 1; i < argc; ++i)
+            selected |= strcmp(argv[i], suite.name) == 0;
+        if (!selected)
+            continue;
+        printf("== %s ==\n", suite.name);
+        suite.run();
+        ++ran;
+    }
+    if (ran == 0)
+    {
+        fprintf(stderr, "unknown suite. available:");
+        for (const Suite &suite : SUITES)
+            fprintf(stderr, " %s", suite.name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "Bench.h"
+#include "Audio_Convert.h"
+#include "Mock_Client.h"
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+// Mock_Host をオブジェクトの数だけ起動し、func_proc と同じ手順
+// (int16 -> float の変換、2048 サンプルごとの分割と往復、float -> int16 の変換) を
+// オブジェクトごとのスレッドで同時に回す。1秒あたりのブロック数、往復の p99、
+// オブジェクト1つあたりの CPU 使用率 (プラグイン側のスレッドとホストのプロセス) を出す
+namespace bench
+{
+    namespace
+    {
+        constexpr int SAMPLE_RATE = 48000;
+        constexpr int FPS = 30;
+        constexpr int FRAME_SAMPLES = SAMPLE_RATE / FPS;
+        constexpr uint32_t TIMEOUT_MS = 1000;
+        constexpr auto DURATION = std::chrono::seconds(2);
+
+        struct ObjectResult
+        {
+            bool ok = true;
+            uint64_t blocks = 0;
+            uint64_t client_cpu_ns = 0;
+            uint64_t host_cpu_ns = 0;
+            std::vector<uint64_t> round_trips;
+        };
+
+        uint64_t ThreadCpuNs()
+        {
+            timespec ts = {};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
+        // /proc/<pid>/stat の utime + stime
+        uint64_t ProcessCpuNs(pid_t pid)
+        {
+            std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+            std::string line;
+            if (!std::getline(stat, line))
+                return 0;
+            // comm は空白を含みうるので、閉じ括弧の後から数える
+            size_t pos = line.rfind(')');
+            if (pos == std::string::npos)
+                return 0;
+            unsigned long long utime = 0, stime = 0;
+            if (sscanf(line.c_str() + pos + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+                return 0;
+            return (utime + stime) * 1000000000ull / static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+        }
+
+        void RunObject(mock_client::Host &host, const std::atomic<bool> &stop, ObjectResult &result)
+        {
+            std::vector<int16_t> audio(FRAME_SAMPLES * 2);
+            for (int i = 0; i < FRAME_SAMPLES; ++i)
+                audio[i * 2] = audio[i * 2 + 1] = static_cast<int16_t>((i * 97) % 20000 - 10000);
+            std::vector<float> in_l(FRAME_SAMPLES), in_r(FRAME_SAMPLES), out_l(FRAME_SAMPLES), out_r(FRAME_SAMPLES);
+            result.round_trips.reserve(8192);
+            const uint64_t client_begin = ThreadCpuNs();
+            const uint64_t host_begin = ProcessCpuNs(host.Pid());
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                audio_convert::ShortToFloatStereo(audio.data(), in_l.data(), in_r.data(), FRAME_SAMPLES);
+                for (int offset = 0; offset < FRAME_SAMPLES; offset += mock_client::LEGACY_BLOCK_SIZE)
+                {
+                    const int samples = std::min(mock_client::LEGACY_BLOCK_SIZE, FRAME_SAMPLES - offset);
+                    const uint64_t start = NowNs();
+                    if (!host.ProcessBlock(in_l.data() + offset, in_r.data() + offset, out_l.data() + offset, out_r.data() + offset, samples, TIMEOUT_MS))
+                    {
+                        result.ok = false;
+                        return;
+                    }
+                    result.round_trips.push_back(NowNs() - start);
+                    ++result.blocks;
+                }
+                audio_convert::FloatToShortStereo(out_l.data(), out_r.data(), audio.data(), FRAME_SAMPLES);
+            }
+            result.client_cpu_ns = ThreadCpuNs() - client_begin;
+            result.host_cpu_ns = ProcessCpuNs(host.Pid()) - host_begin;
+        }
+
+        void RunCase(int objects, int cost_us)
+        {
+            std::vector<std::unique_ptr<mock_client::Host>> hosts;
+            for (int i = 0; i < objects; ++i)
+            {
+                hosts.push_back(std::make_unique<mock_client::Host>());
+                if (!hosts.back()->Start(BENCH_MOCK_HOST_PATH, {"-cost_us", std::to_string(cost_us)}))
+                {
+                    printf("  failed to start %s\n", BENCH_MOCK_HOST_PATH);
+                    return;
+                }
+            }
+            std::atomic<bool> stop = false;
+            std::vector<ObjectResult> results(objects);
+            std::vector<std::thread> threads;
+            const uint64_t begin = NowNs();
+            for (int i = 0; i < objects; ++i)
+                threads.emplace_back(RunObject, std::ref(*hosts[i]), std::cref(stop), std::ref(results[i]));
+            std::this_thread::sleep_for(DURATION);
+            stop = true;
+            for (auto &thread : threads)
+                thread.join();
+            const double seconds = static_cast<double>(NowNs() - begin) / 1e9;
+
+            uint64_t blocks = 0, client_cpu_ns = 0, host_cpu_ns = 0;
+            std::vector<uint64_t> round_trips;
+            for (auto &result : results)
+            {
+                if (!result.ok)
+                {
+                    printf("  %2d objects, cost %4d us: timed out\n", objects, cost_us);
+                    return;
+                }
+                blocks += result.blocks;
+                client_cpu_ns += result.client_cpu_ns;
+                host_cpu_ns += result.host_cpu_ns;
+                round_trips.insert(round_trips.end(), result.round_trips.begin(), result.round_trips.end());
+            }
+            // リアルタイムに必要なのは 1 オブジェクトあたり FPS ブロック/秒 (FRAME_SAMPLES <= 2048 のため)
+            const double per_object_cpu = 100.0 / seconds / 1e9 / objects;
+            printf("  %2d objects, cost %4d us: %9.0f blocks/s (%7.1fx realtime/object)  p99 %8.2f us  cpu/object: plugin %5.1f%%  host %5.1f%%\n",
+                   objects, cost_us, static_cast<double>(blocks) / seconds, static_cast<double>(blocks) / seconds / objects / FPS,
+                   static_cast<double>(Percentile(round_trips, 0.99)) / 1000.0,
+                   static_cast<double>(client_cpu_ns) * per_object_cpu, static_cast<double>(host_cpu_ns) * per_object_cpu);
+        }
+    }
+
+    void RunMockHost()
+    {
+        printf("  %d Hz, %d fps (%d samples/frame), legacy 2048-sample blocks, %s\n", SAMPLE_RATE, FPS, FRAME_SAMPLES, BENCH_MOCK_HOST_PATH);
+        for (int cost_us : {0, 200})
+        {
+            for (int objects : {1, 4, 8})
+                RunCase(objects, cost_us);
+        }
+    }
+}
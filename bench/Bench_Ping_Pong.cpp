@@ -0,0 +1,130 @@
+#include "Bench.h"
+#include "Ipc_Transport.h"
+#include "Spin_Signal.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// 往復1回 (クライアントが投入 -> ホストが完了を返す) の遅延の分布。
+// ホスト側は処理を行わず、通知の方式だけを比べる
+//   event      : ipc_transport::Signal (POSIX では共有メモリ上の futex) を毎回 Set / Wait する従来の方式
+//   spin_signal: seq をスピンで待ち、相手が眠っている場合だけ futex で起こす (ring_signal::spin)
+namespace bench
+{
+    namespace
+    {
+        constexpr int ITERATIONS = 20000;
+        constexpr int WARMUP = 1000;
+        constexpr uint32_t TIMEOUT_MS = 1000;
+
+        void Report(const char *name, std::vector<uint64_t> &samples)
+        {
+            double p50 = static_cast<double>(Percentile(samples, 0.50)) / 1000.0;
+            double p99 = static_cast<double>(Percentile(samples, 0.99)) / 1000.0;
+            double p999 = static_cast<double>(Percentile(samples, 0.999)) / 1000.0;
+            printf("  %-22s p50 %8.2f us  p99 %8.2f us  p99.9 %8.2f us\n", name, p50, p99, p999);
+        }
+
+        void RunEvent()
+        {
+            const std::string suffix = std::to_string(getpid());
+            ipc_transport::Signal client_ready, host_done, host_ready, host_done_peer;
+            if (!client_ready.Create(("Local\\BenchPingReady_" + suffix).c_str()) || !host_done.Create(("Local\\BenchPingDone_" + suffix).c_str()) ||
+                !host_ready.Open(("Local\\BenchPingReady_" + suffix).c_str()) || !host_done_peer.Open(("Local\\BenchPingDone_" + suffix).c_str()))
+            {
+                printf("  event: failed to create signals (%u)\n", ipc_transport::LastError());
+                return;
+            }
+            std::atomic<bool> stop = false;
+            std::thread host([&]
+                             {
+                                 while (!stop.load(std::memory_order_relaxed))
+                                 {
+                                     if (host_ready.Wait(100) == ipc_transport::WaitResult::signaled)
+                                         host_done_peer.Set();
+                                 } });
+            std::vector<uint64_t> samples;
+            samples.reserve(ITERATIONS);
+            for (int i = 0; i < WARMUP + ITERATIONS; ++i)
+            {
+                uint64_t start = NowNs();
+                host_done.Reset();
+                client_ready.Set();
+                if (host_done.Wait(TIMEOUT_MS) != ipc_transport::WaitResult::signaled)
+                {
+                    printf("  event: timed out\n");
+                    break;
+                }
+                if (i >= WARMUP)
+                    samples.push_back(NowNs() - start);
+            }
+            stop = true;
+            host.join();
+            Report("event", samples);
+        }
+
+        // RingHeader / RingSlotHeader の該当部分だけを取り出したもの
+        struct alignas(64) SpinWords
+        {
+            uint32_t submit_seq = 0;
+            uint32_t done_seq = 0;
+            uint32_t client_sleeping = 0;
+            uint32_t host_sleeping = 0;
+        };
+
+        void RunSpin(const char *name, uint32_t spin_us)
+        {
+            SpinWords words;
+            std::atomic<bool> stop = false;
+            auto block = [](uint32_t &word)
+            {
+                return [&word](uint32_t observed, uint32_t wait_ms)
+                { spin_signal::FutexWait(&word, observed, wait_ms); };
+            };
+            std::thread host([&]
+                             {
+                                 uint32_t seq = 1;
+                                 while (!stop.load(std::memory_order_relaxed))
+                                 {
+                                     if (!spin_signal::WaitFor(words.submit_seq, seq, words.host_sleeping, spin_us, 100, block(words.submit_seq)))
+                                         continue;
+                                     spin_signal::Publish(words.done_seq, seq, words.client_sleeping, [&]
+                                                          { spin_signal::FutexWake(&words.done_seq); });
+                                     ++seq;
+                                 } });
+            std::vector<uint64_t> samples;
+            samples.reserve(ITERATIONS);
+            for (uint32_t seq = 1; seq <= WARMUP + ITERATIONS; ++seq)
+            {
+                uint64_t start = NowNs();
+                spin_signal::Publish(words.submit_seq, seq, words.host_sleeping, [&]
+                                     { spin_signal::FutexWake(&words.submit_seq); });
+                if (!spin_signal::WaitFor(words.done_seq, seq, words.client_sleeping, spin_us, TIMEOUT_MS, block(words.done_seq)))
+                {
+                    printf("  %s: timed out\n", name);
+                    break;
+                }
+                if (seq > WARMUP)
+                    samples.push_back(NowNs() - start);
+            }
+            stop = true;
+            // 眠っているホストを起こして終了させる
+            std::atomic_ref<uint32_t>(words.submit_seq).fetch_add(1);
+            spin_signal::FutexWake(&words.submit_seq);
+            host.join();
+            Report(name, samples);
+        }
+    }
+
+    void RunPingPong()
+    {
+        printf("  %u hardware threads, %d round trips\n", std::thread::hardware_concurrency(), ITERATIONS);
+        if (std::thread::hardware_concurrency() < 2)
+            printf("  (single core: spinning only delays the peer, so spin_signal with spin is expected to lose)\n");
+        RunEvent();
+        RunSpin("spin_signal (100 us)", 100);
+        RunSpin("spin_signal (no spin)", 0);
+    }
+}
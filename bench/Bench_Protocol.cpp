@@ -0,0 +1,65 @@
+#include "Bench.h"
+#include "Ipc_Protocol.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 大きな状態 (サンプラーやコンボリューションの IR など) を送るときのコスト。
+// テキストプロトコルの base64 と、バイナリプロトコルのフレーム化を比べる
+namespace bench
+{
+    namespace
+    {
+        template <class Fn>
+        double MeasureMBps(size_t bytes, Fn &&fn)
+        {
+            fn();
+            int iterations = 0;
+            uint64_t start = NowNs(), elapsed = 0;
+            do
+            {
+                fn();
+                ++iterations;
+                elapsed = NowNs() - start;
+            } while (elapsed < 300000000ull);
+            return static_cast<double>(bytes) * iterations / (static_cast<double>(elapsed) / 1e9) / 1e6;
+        }
+    }
+
+    void RunProtocol()
+    {
+        const size_t sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+        printf("  %-10s %14s %14s %14s %14s\n", "state", "b64 encode", "b64 decode", "frame encode", "frame split");
+        for (size_t size : sizes)
+        {
+            std::vector<uint8_t> state(size);
+            for (size_t i = 0; i < size; ++i)
+                state[i] = static_cast<uint8_t>(i * 131 + (i >> 8));
+            std::string encoded;
+            std::vector<uint8_t> decoded, frame;
+            const std::string command = "load_and_set_state \"C:\\\\Plugins\\\\Sampler.vst3\" 48000 2048";
+
+            double b64_encode = MeasureMBps(size, [&]
+                                            { ipc_protocol::Base64Encode(state.data(), state.size(), encoded); });
+            double b64_decode = MeasureMBps(size, [&]
+                                            { ipc_protocol::Base64Decode(encoded, decoded); });
+            double frame_encode = MeasureMBps(size, [&]
+                                              { ipc_protocol::EncodeCommandWithState(0, command, state.data(), state.size(), frame); });
+            double frame_split = MeasureMBps(size, [&]
+                                             {
+                                                 ipc_protocol::FrameHeader header;
+                                                 std::string_view parsed;
+                                                 const uint8_t *payload_state = nullptr;
+                                                 size_t payload_state_size = 0;
+                                                 if (ipc_protocol::DecodeHeader(frame.data(), frame.size(), header) == ipc_protocol::DecodeResult::ok)
+                                                     ipc_protocol::SplitCommandWithState(frame.data() + sizeof(header), header.payload_size, parsed, payload_state, payload_state_size);
+                                                 // 受信側は状態を自分のバッファへ写すので、その分も含める
+                                                 decoded.assign(payload_state, payload_state + payload_state_size); });
+            char label[32];
+            snprintf(label, sizeof(label), "%zu KB", size / 1024);
+            printf("  %-10s %9.0f MB/s %9.0f MB/s %9.0f MB/s %9.0f MB/s   (base64 %zu bytes, frame %zu bytes)\n",
+                   label, b64_encode, b64_decode, frame_encode, frame_split, encoded.size(), frame.size());
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#include "Bench.h"
+#include "Shared_Layout.h"
+#include <cmath>
+#include <cstdio>
+
+// サンプリングレートとフレームレートごとの、1秒あたりの往復回数。
+// 固定 2048 サンプルのブロックと、NegotiateRingBlockSize で決めたブロックを比べる
+namespace bench
+{
+    namespace
+    {
+        constexpr int LEGACY_BLOCK_SIZE = 2048;
+        // max_block を報告する小さいブロック向けのホストの例
+        constexpr uint32_t SMALL_HOST_MAX_BLOCK = 512;
+
+        struct FrameRate
+        {
+            const char *name;
+            int rate;
+            int scale;
+        };
+
+        // フレーム f に割り当てられるサンプル数 (AviUtl と同じく累積位置の差で求める)
+        int FrameSamples(int sample_rate, const FrameRate &fps, int frame)
+        {
+            auto position = [&](int f)
+            { return static_cast<int64_t>(f) * sample_rate * fps.scale / fps.rate; };
+            return static_cast<int>(position(frame + 1) - position(frame));
+        }
+
+        int RoundTrips(int samples, int block_size)
+        {
+            return (samples + block_size - 1) / block_size;
+        }
+    }
+
+    void RunRoundTrips()
+    {
+        const int sample_rates[] = {44100, 48000, 96000, 192000};
+        const FrameRate frame_rates[] = {{"10", 10, 1}, {"23.976", 24000, 1001}, {"30", 30, 1}, {"59.94", 60000, 1001}, {"60", 60, 1}};
+        printf("  %-7s %-7s %8s | %-14s | %-20s | %-20s\n", "rate", "fps", "samples", "fixed 2048", "negotiated", "host max 512");
+        for (int sample_rate : sample_rates)
+        {
+            for (const FrameRate &fps : frame_rates)
+            {
+                const int frames = static_cast<int>(std::ceil(static_cast<double>(fps.rate) / fps.scale));
+                // ブロックサイズは起動時のフレームの audio_n で決まる
+                const int first_samples = FrameSamples(sample_rate, fps, 0);
+                const int negotiated = NegotiateRingBlockSize(first_samples, 0);
+                const int small = NegotiateRingBlockSize(first_samples, SMALL_HOST_MAX_BLOCK);
+                int legacy_trips = 0, negotiated_trips = 0, small_trips = 0;
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    int samples = FrameSamples(sample_rate, fps, frame);
+                    legacy_trips += RoundTrips(samples, LEGACY_BLOCK_SIZE);
+                    negotiated_trips += RoundTrips(samples, negotiated);
+                    small_trips += RoundTrips(samples, small);
+                }
+                printf("  %-7d %-7s %8d | %5d/s %4.2f/f | %5d %5d/s %4.2f/f | %5d %5d/s %4.2f/f\n",
+                       sample_rate, fps.name, first_samples,
+                       legacy_trips, static_cast<double>(legacy_trips) / frames,
+                       negotiated, negotiated_trips, static_cast<double>(negotiated_trips) / frames,
+                       small, small_trips, static_cast<double>(small_trips) / frames);
+            }
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#include "Audio_Convert.h"
+#include "Test_Util.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+// SIMD 版がスカラー版とビット単位で同じ結果を返すことを、端数の長さとクリップの境界で確かめる
+namespace
+{
+    using audio_convert::Isa;
+
+    // 端数の処理とループの切り替わりを通る長さ
+    const int LENGTHS[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 127, 1601, 2048 + 7};
+    constexpr int MAX_FRAMES = 2048 + 7;
+
+    std::vector<int16_t> MakeShorts(size_t count, std::mt19937 &random)
+    {
+        std::vector<int16_t> values(count);
+        std::uniform_int_distribution<int> dist(-32768, 32767);
+        for (auto &value : values)
+            value = static_cast<int16_t>(dist(random));
+        const int16_t edges[] = {-32768, -32767, -1, 0, 1, 32766, 32767};
+        for (size_t i = 0; i < values.size() && i < std::size(edges); ++i)
+            values[i * 3 % values.size()] = edges[i];
+        return values;
+    }
+
+    // 範囲外・無限大・境界付近の値を混ぜる (NaN は std::clamp の結果が未定義のため含めない)
+    std::vector<float> MakeFloats(size_t count, std::mt19937 &random)
+    {
+        std::vector<float> values(count);
+        std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+        for (auto &value : values)
+            value = dist(random);
+        const float edges[] = {-std::numeric_limits<float>::infinity(), -2.0f, -1.0f, -0.99999994f, -1.0f / 32767, -0.0f, 0.0f,
+                               1.0f / 32767, 0.5f, 0.99999994f, 1.0f, 1.0000001f, 3.0f, std::numeric_limits<float>::infinity()};
+        for (size_t i = 0; i < values.size() && i < std::size(edges); ++i)
+            values[i * 5 % values.size()] = edges[i];
+        return values;
+    }
+
+    struct Outputs
+    {
+        std::vector<float> mono, left, right;
+        std::vector<int16_t> mono_out, stereo_out, downmix_out;
+        bool silent_input = false, silent_zero = false;
+    };
+
+    Outputs Run(int frames, const std::vector<int16_t> &shorts, const std::vector<float> &floats_l, const std::vector<float> &floats_r)
+    {
+        Outputs out;
+        out.mono.assign(frames, -7.0f);
+        out.left.assign(frames, -7.0f);
+        out.right.assign(frames, -7.0f);
+        out.mono_out.assign(frames, 12345);
+        out.stereo_out.assign(frames * 2, 12345);
+        out.downmix_out.assign(frames, 12345);
+        audio_convert::ShortToFloatMono(shorts.data(), out.mono.data(), frames);
+        audio_convert::ShortToFloatStereo(shorts.data(), out.left.data(), out.right.data(), frames);
+        audio_convert::FloatToShortMono(floats_l.data(), out.mono_out.data(), frames);
+        audio_convert::FloatToShortStereo(floats_l.data(), floats_r.data(), out.stereo_out.data(), frames);
+        audio_convert::FloatToShortDownmix(floats_l.data(), floats_r.data(), out.downmix_out.data(), frames);
+        out.silent_input = audio_convert::IsSilent(shorts.data(), static_cast<size_t>(frames) * 2);
+        std::vector<int16_t> zeros(static_cast<size_t>(frames) * 2, 0);
+        out.silent_zero = audio_convert::IsSilent(zeros.data(), zeros.size());
+        return out;
+    }
+
+    bool SameBits(const std::vector<float> &a, const std::vector<float> &b)
+    {
+        return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    }
+
+    void TestScalarValues()
+    {
+        audio_convert::SelectIsa(Isa::scalar);
+        const int16_t in[] = {-32768, 0, 16384, 32767};
+        float out[4];
+        audio_convert::ShortToFloatMono(in, out, 4);
+        CHECK(out[0] == -1.0f && out[1] == 0.0f && out[2] == 0.5f && out[3] == 32767.0f / 32768.0f);
+
+        const float values[] = {-2.0f, -1.0f, 0.5f, 1.0f, 1.5f, 0.99999994f};
+        int16_t shorts[6];
+        audio_convert::FloatToShortMono(values, shorts, 6);
+        CHECK(shorts[0] == -32767 && shorts[1] == -32767 && shorts[2] == 16383 && shorts[3] == 32767 && shorts[4] == 32767 && shorts[5] == 32766);
+
+        const float left[] = {1.0f, 2.0f, -1.0f};
+        const float right[] = {0.0f, 2.0f, 1.0f};
+        int16_t mixed[3];
+        audio_convert::FloatToShortDownmix(left, right, mixed, 3);
+        CHECK(mixed[0] == 16383 && mixed[1] == 32767 && mixed[2] == 0);
+    }
+
+    void TestSimdMatchesScalar()
+    {
+        std::mt19937 random(20240601);
+        const auto shorts = MakeShorts(MAX_FRAMES * 2, random);
+        const auto floats_l = MakeFloats(MAX_FRAMES, random);
+        const auto floats_r = MakeFloats(MAX_FRAMES, random);
+        for (Isa isa : {Isa::sse2, Isa::avx2})
+        {
+            if (!audio_convert::SelectIsa(isa))
+            {
+                std::printf("ISA %d is not available on this CPU. Skipped.\n", static_cast<int>(isa));
+                continue;
+            }
+            for (int frames : LENGTHS)
+            {
+                audio_convert::SelectIsa(Isa::scalar);
+                const Outputs expected = Run(frames, shorts, floats_l, floats_r);
+                audio_convert::SelectIsa(isa);
+                const Outputs actual = Run(frames, shorts, floats_l, floats_r);
+                CHECK(SameBits(actual.mono, expected.mono));
+                CHECK(SameBits(actual.left, expected.left));
+                CHECK(SameBits(actual.right, expected.right));
+                CHECK(actual.mono_out == expected.mono_out);
+                CHECK(actual.stereo_out == expected.stereo_out);
+                CHECK(actual.downmix_out == expected.downmix_out);
+                CHECK(actual.silent_input == expected.silent_input);
+                CHECK(actual.silent_zero && expected.silent_zero);
+            }
+        }
+    }
+
+    // 0 の中に1つだけ 0 でないサンプルがある場合、どの位置でも検出できる
+    void TestSilenceDetection()
+    {
+        std::vector<int16_t> samples(300, 0);
+        for (Isa isa : {Isa::scalar, Isa::sse2, Isa::avx2})
+        {
+            if (!audio_convert::SelectIsa(isa))
+                continue;
+            for (size_t count = 0; count <= 200; ++count)
+            {
+                CHECK(audio_convert::IsSilent(samples.data() + 1, count));
+                for (size_t pos = 0; pos < count; ++pos)
+                {
+                    samples[1 + pos] = -1;
+                    CHECK(!audio_convert::IsSilent(samples.data() + 1, count));
+                    samples[1 + pos] = 0;
+                }
+            }
+        }
+    }
+
+    // 1ch / 2ch 以外の汎用経路と、int16 -> float -> int16 の往復
+    void TestPlanarRoundTrip()
+    {
+        std::mt19937 random(7);
+        for (int channels : {1, 2, 3, 6})
+        {
+            const int frames = 1601;
+            const auto input = MakeShorts(static_cast<size_t>(frames) * channels, random);
+            std::vector<std::vector<float>> planes(channels, std::vector<float>(frames));
+            std::vector<float *> plane_ptrs;
+            for (auto &plane : planes)
+                plane_ptrs.push_back(plane.data());
+            audio_convert::ShortToFloatPlanar(input.data(), channels, plane_ptrs.data(), frames);
+            for (int ch = 0; ch < channels; ++ch)
+                CHECK(planes[ch][7] == static_cast<float>(input[7 * channels + ch]) / 32768.0f);
+            std::vector<int16_t> output(input.size());
+            audio_convert::FloatToShortInterleaved(plane_ptrs.data(), channels, output.data(), frames);
+            // x / 32768 * 32767 の切り捨てで、負の値は 1 だけ 0 に寄ることがある
+            bool close = true;
+            for (size_t i = 0; i < input.size(); ++i)
+                close &= std::abs(output[i] - input[i]) <= 1;
+            CHECK(close);
+        }
+    }
+}
+
+int main()
+{
+    TestScalarValues();
+    TestSimdMatchesScalar();
+    TestSilenceDetection();
+    TestPlanarRoundTrip();
+    return TEST_RESULT();
+}
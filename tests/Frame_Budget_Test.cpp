@@ -0,0 +1,56 @@
+#include "Frame_Budget.h"
+#include "Test_Util.h"
+
+using namespace frame_budget;
+
+namespace
+{
+    void TestEstimator()
+    {
+        RoundTripEstimator estimator;
+        CHECK(!estimator.HasSamples());
+        CHECK(estimator.TimeoutMs(500) == 500);
+        estimator.Add(2000);
+        CHECK(estimator.HasSamples());
+        // srtt 2 ms + 4 * rttvar 1 ms
+        CHECK(estimator.TimeoutMs(500) == 6);
+        CHECK(estimator.TimeoutMs(3) == 3);
+        CHECK(estimator.PredictUs(4) == 8000);
+        estimator.Decay();
+        CHECK(estimator.PredictUs(4) == 6000);
+        estimator.Reset();
+        CHECK(!estimator.HasSamples());
+    }
+
+    void TestScheduler()
+    {
+        Scheduler scheduler;
+        scheduler.Enter(0, 1000, 33, 0);
+        CHECK(scheduler.Unlimited());
+        CHECK(scheduler.RemainingUs(1000000) == UINT64_MAX);
+
+        scheduler.Enter(1, 1000, 33, 20);
+        CHECK(scheduler.BudgetUs() == 20000);
+        CHECK(scheduler.RemainingUs(6000) == 15000);
+        CHECK(scheduler.RemainingMs(6001) == 15);
+        // 同じフレームの別のオブジェクトは予算を共有する
+        scheduler.Enter(1, 11000, 33, 20);
+        CHECK(scheduler.RemainingUs(11000) == 10000);
+        // プリロールにかかった時間は締め切りに含めない
+        scheduler.Extend(8000);
+        CHECK(scheduler.RemainingUs(19000) == 10000);
+        CHECK(scheduler.RemainingUs(40000) == 0);
+        // 締め切りから frame_ms 以上過ぎた同じフレームは描画し直しとして新しい予算を始める
+        scheduler.Enter(1, 29000 + 33000, 33, 20);
+        CHECK(scheduler.RemainingUs(29000 + 33000) == 20000);
+        scheduler.Enter(2, 70000, 33, 20);
+        CHECK(scheduler.RemainingUs(70000) == 20000);
+    }
+}
+
+int main()
+{
+    TestEstimator();
+    TestScheduler();
+    return TEST_RESULT();
+}
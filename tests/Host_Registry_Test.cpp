@@ -0,0 +1,235 @@
+#include "Host_Registry.h"
+#include "Mock_Client.h"
+#include "Test_Util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 複数のスレッドが Acquire / Remove / 起動要求 / 巡回を同時に行う負荷試験。
+// オブジェクト 0 のホストだけを遅くし、他のオブジェクトの処理がその待ちに巻き込まれないことを確かめる
+// 使い方: host_registry_test <Mock_Host のパス>
+namespace
+{
+    constexpr uint32_t OBJECT_COUNT = 8;
+    constexpr uint32_t SLOW_OBJECT = 0;
+    constexpr int SLOW_JITTER_US = 100000;
+    constexpr int WORKER_COUNT = 4;
+    constexpr auto TEST_DURATION = std::chrono::seconds(3);
+    constexpr int BLOCK_SAMPLES = 256;
+    constexpr uint32_t BLOCK_TIMEOUT_MS = 5000;
+
+    enum class Status
+    {
+        idle,
+        launching,
+        ready,
+        failed,
+    };
+
+    struct TestState
+    {
+        uint32_t object_id = 0;
+        int generation = 0;
+        std::atomic<Status> status = Status::idle;
+        // ホストとの通信を保護する
+        std::mutex mutex;
+        mock_client::Host host;
+    };
+
+    struct TestRequest
+    {
+        std::shared_ptr<TestState> state;
+    };
+
+    std::string g_mock_host_path;
+    std::atomic<int> g_generations[OBJECT_COUNT] = {};
+    std::atomic<uint64_t> g_launches = 0;
+    std::atomic<uint64_t> g_skipped_launches = 0;
+    std::atomic<uint64_t> g_launch_failures = 0;
+    std::atomic<uint64_t> g_block_failures = 0;
+    std::atomic<uint64_t> g_mismatches = 0;
+    std::atomic<uint64_t> g_removals = 0;
+    std::atomic<uint64_t> g_syncs = 0;
+
+    void Launch(TestRequest &request)
+    {
+        TestState &state = *request.state;
+        if (request.state.use_count() == 1)
+        {
+            ++g_skipped_launches;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        std::vector<std::string> args;
+        if (state.object_id == SLOW_OBJECT)
+            args = {"-jitter_us", std::to_string(SLOW_JITTER_US)};
+        if (!state.host.Start(g_mock_host_path, args))
+        {
+            ++g_launch_failures;
+            state.status = Status::failed;
+            return;
+        }
+        ++g_launches;
+        state.status = Status::ready;
+    }
+
+    host_registry::Registry<TestState> g_registry;
+    host_registry::Launcher<TestRequest> g_launcher("test_launcher", Launch);
+
+    std::shared_ptr<TestState> Acquire(uint32_t object_id)
+    {
+        std::shared_ptr<TestState> replaced;
+        const int generation = g_generations[object_id];
+        return g_registry.Acquire(
+            object_id, [&](const TestState &state)
+            { return state.generation == generation; },
+            [&]
+            {
+                auto state = std::make_shared<TestState>();
+                state->object_id = object_id;
+                state->generation = generation;
+                return state;
+            },
+            replaced);
+    }
+
+    struct Latencies
+    {
+        std::mutex mutex;
+        std::vector<uint64_t> fast_us, slow_us;
+    };
+
+    // func_proc と同じ手順: 登録簿から取得 -> 未起動なら起動要求 -> 起動済みなら状態のロックの下で1ブロック往復
+    void Worker(int index, std::chrono::steady_clock::time_point end, Latencies &latencies)
+    {
+        std::mt19937 random(index);
+        std::vector<float> in_l(BLOCK_SAMPLES), in_r(BLOCK_SAMPLES), out_l(BLOCK_SAMPLES), out_r(BLOCK_SAMPLES);
+        std::vector<uint64_t> fast, slow;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            const uint32_t object_id = random() % OBJECT_COUNT;
+            const auto started = std::chrono::steady_clock::now();
+            auto state = Acquire(object_id);
+            Status status = state->status;
+            if (status == Status::idle)
+            {
+                if (state->status.compare_exchange_strong(status, Status::launching))
+                    g_launcher.Submit({state});
+                continue;
+            }
+            if (status != Status::ready)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            for (int i = 0; i < BLOCK_SAMPLES; ++i)
+            {
+                in_l[i] = static_cast<float>(random() % 1000) / 1000.0f;
+                in_r[i] = -in_l[i];
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->host.ProcessBlock(in_l.data(), in_r.data(), out_l.data(), out_r.data(), BLOCK_SAMPLES, BLOCK_TIMEOUT_MS))
+                {
+                    ++g_block_failures;
+                    continue;
+                }
+            }
+            if (in_l != out_l || in_r != out_r)
+                ++g_mismatches;
+            const uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+            (object_id == SLOW_OBJECT ? slow : fast).push_back(elapsed);
+        }
+        std::lock_guard<std::mutex> lock(latencies.mutex);
+        latencies.fast_us.insert(latencies.fast_us.end(), fast.begin(), fast.end());
+        latencies.slow_us.insert(latencies.slow_us.end(), slow.begin(), slow.end());
+    }
+
+    // オブジェクトの削除と、プラグインの変更による作り直し
+    void Remover(std::chrono::steady_clock::time_point end)
+    {
+        std::mt19937 random(99);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20 + random() % 30));
+            const uint32_t object_id = 1 + random() % (OBJECT_COUNT - 1);
+            if (random() % 2)
+                ++g_generations[object_id];
+            else if (g_registry.Remove(object_id))
+                ++g_removals;
+        }
+    }
+
+    // StateSyncer と同じく、写しを巡回して空いているホストにだけコマンドを送る
+    void Syncer(std::chrono::steady_clock::time_point end)
+    {
+        while (std::chrono::steady_clock::now() < end)
+        {
+            for (auto &[object_id, state] : g_registry.Snapshot())
+            {
+                if (state->status != Status::ready)
+                    continue;
+                std::unique_lock<std::mutex> lock(state->mutex, std::try_to_lock);
+                std::string response;
+                if (lock.owns_lock() && state->host.Command("get_state", response) && response.rfind("OK ", 0) == 0)
+                    ++g_syncs;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: host_registry_test <Mock_Host>\n");
+        return 2;
+    }
+    g_mock_host_path = argv[1];
+
+    Latencies latencies;
+    const auto end = std::chrono::steady_clock::now() + TEST_DURATION;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < WORKER_COUNT; ++i)
+        threads.emplace_back(Worker, i, end, std::ref(latencies));
+    threads.emplace_back(Remover, end);
+    threads.emplace_back(Syncer, end);
+    for (auto &thread : threads)
+        thread.join();
+    g_launcher.Stop();
+    g_registry.Clear();
+
+    const uint64_t fast_p99 = latencies.fast_us.empty() ? 0 : [&]
+    {
+        auto &v = latencies.fast_us;
+        std::sort(v.begin(), v.end());
+        return v[v.size() * 99 / 100];
+    }();
+    const uint64_t slow_p50 = latencies.slow_us.empty() ? 0 : [&]
+    {
+        auto &v = latencies.slow_us;
+        std::sort(v.begin(), v.end());
+        return v[v.size() / 2];
+    }();
+    printf("launches %llu (skipped %llu), removals %llu, syncs %llu\n",
+           static_cast<unsigned long long>(g_launches.load()), static_cast<unsigned long long>(g_skipped_launches.load()),
+           static_cast<unsigned long long>(g_removals.load()), static_cast<unsigned long long>(g_syncs.load()));
+    printf("fast blocks %zu p99 %llu us, slow blocks %zu p50 %llu us\n",
+           latencies.fast_us.size(), static_cast<unsigned long long>(fast_p99),
+           latencies.slow_us.size(), static_cast<unsigned long long>(slow_p50));
+
+    CHECK(g_launch_failures == 0);
+    CHECK(g_block_failures == 0);
+    CHECK(g_mismatches == 0);
+    CHECK(g_removals > 0);
+    CHECK(g_syncs > 0);
+    CHECK(!latencies.fast_us.empty() && !latencies.slow_us.empty());
+    // 遅いホストの往復がロックを通じて他のオブジェクトを待たせていれば、速いホストの p99 も同程度になる
+    CHECK(fast_p99 < slow_p50);
+    return TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+#include "Ipc_Protocol.h"
+#include "Test_Util.h"
+#include <cstring>
+#include <random>
+
+using namespace ipc_protocol;
+
+namespace
+{
+    FrameHeader Header(const std::vector<uint8_t> &frame)
+    {
+        FrameHeader header = {};
+        memcpy(&header, frame.data(), sizeof(header));
+        return header;
+    }
+
+    void TestFrameRoundTrip()
+    {
+        const char text[] = "set_param 3 0.5";
+        std::vector<uint8_t> frame;
+        CHECK(EncodeFrame(MessageType::command, 7, text, strlen(text), frame));
+        CHECK(frame.size() == sizeof(FrameHeader) + strlen(text));
+        FrameHeader header;
+        CHECK(DecodeHeader(frame.data(), frame.size(), header) == DecodeResult::ok);
+        CHECK(header.type == static_cast<uint16_t>(MessageType::command));
+        CHECK(header.instance_id == 7);
+        CHECK(header.payload_size == strlen(text));
+        CHECK(memcmp(frame.data() + sizeof(FrameHeader), text, strlen(text)) == 0);
+
+        // 出力先の前の内容は残らない
+        CHECK(EncodeFrame(MessageType::ok, -1, nullptr, 0, frame));
+        CHECK(frame.size() == sizeof(FrameHeader));
+        CHECK(DecodeHeader(frame.data(), frame.size(), header) == DecodeResult::ok);
+        CHECK(header.payload_size == 0 && header.instance_id == -1);
+    }
+
+    void TestMalformedHeaders()
+    {
+        std::vector<uint8_t> frame;
+        EncodeFrame(MessageType::state, 0, "abc", 3, frame);
+        FrameHeader header;
+        for (size_t size = 0; size < sizeof(FrameHeader); ++size)
+            CHECK(DecodeHeader(frame.data(), size, header) == DecodeResult::truncated);
+
+        std::vector<uint8_t> broken = frame;
+        broken[0] ^= 0xff;
+        CHECK(DecodeHeader(broken.data(), broken.size(), header) == DecodeResult::bad_magic);
+
+        FrameHeader raw = Header(frame);
+        raw.version = VERSION + 1;
+        CHECK(DecodeHeader(&raw, sizeof(raw), header) == DecodeResult::bad_version);
+
+        raw = Header(frame);
+        raw.payload_size = MAX_PAYLOAD_SIZE;
+        CHECK(DecodeHeader(&raw, sizeof(raw), header) == DecodeResult::ok);
+        raw.payload_size = MAX_PAYLOAD_SIZE + 1;
+        CHECK(DecodeHeader(&raw, sizeof(raw), header) == DecodeResult::too_large);
+        raw.payload_size = UINT32_MAX;
+        CHECK(DecodeHeader(&raw, sizeof(raw), header) == DecodeResult::too_large);
+    }
+
+    void TestOversizeEncode()
+    {
+        // 実際に読まれる前に大きさで断るため、ポインタの先は小さくてよい
+        const uint8_t byte = 0;
+        std::vector<uint8_t> frame = {1, 2, 3};
+        CHECK(!EncodeFrame(MessageType::state, 0, &byte, size_t(MAX_PAYLOAD_SIZE) + 1, frame));
+        CHECK(frame.size() == 3);
+        CHECK(!EncodeCommandWithState(0, "load", &byte, MAX_PAYLOAD_SIZE, frame));
+        CHECK(frame.size() == 3);
+    }
+
+    void TestCommandWithState()
+    {
+        const uint8_t state[] = {0, 1, 2, 0xff, '\n', 0};
+        std::vector<uint8_t> frame;
+        CHECK(EncodeCommandWithState(3, "load_and_set_state \"a b.vst3\" 48000 2048", state, sizeof(state), frame));
+        FrameHeader header;
+        CHECK(DecodeHeader(frame.data(), frame.size(), header) == DecodeResult::ok);
+        CHECK(header.type == static_cast<uint16_t>(MessageType::command_with_state));
+        CHECK(frame.size() == sizeof(FrameHeader) + header.payload_size);
+
+        std::string_view command;
+        const uint8_t *decoded = nullptr;
+        size_t decoded_size = 0;
+        const uint8_t *payload = frame.data() + sizeof(FrameHeader);
+        CHECK(SplitCommandWithState(payload, header.payload_size, command, decoded, decoded_size));
+        CHECK(command == "load_and_set_state \"a b.vst3\" 48000 2048");
+        CHECK(decoded_size == sizeof(state) && memcmp(decoded, state, sizeof(state)) == 0);
+
+        // 空の状態と空のコマンド
+        CHECK(EncodeCommandWithState(0, "", nullptr, 0, frame));
+        CHECK(DecodeHeader(frame.data(), frame.size(), header) == DecodeResult::ok);
+        CHECK(header.payload_size == sizeof(uint32_t));
+        CHECK(SplitCommandWithState(frame.data() + sizeof(FrameHeader), header.payload_size, command, decoded, decoded_size));
+        CHECK(command.empty() && decoded_size == 0);
+
+        // 長さの欄が足りない・コマンド長がペイロードを超える
+        CHECK(!SplitCommandWithState(payload, 3, command, decoded, decoded_size));
+        CHECK(!SplitCommandWithState(payload, 0, command, decoded, decoded_size));
+        const uint8_t too_long[] = {10, 0, 0, 0, 'a', 'b'};
+        CHECK(!SplitCommandWithState(too_long, sizeof(too_long), command, decoded, decoded_size));
+        const uint8_t huge[] = {0xff, 0xff, 0xff, 0xff};
+        CHECK(!SplitCommandWithState(huge, sizeof(huge), command, decoded, decoded_size));
+    }
+
+    void TestBase64()
+    {
+        std::mt19937 random(1);
+        for (size_t size = 0; size < 70; ++size)
+        {
+            std::vector<uint8_t> data(size);
+            for (auto &byte : data)
+                byte = static_cast<uint8_t>(random());
+            std::string encoded;
+            Base64Encode(data.data(), data.size(), encoded);
+            CHECK(encoded.size() == (size + 2) / 3 * 4);
+            std::vector<uint8_t> decoded;
+            CHECK(Base64Decode(encoded, decoded));
+            CHECK(decoded == data);
+        }
+        std::string encoded;
+        Base64Encode(reinterpret_cast<const uint8_t *>("mock"), 4, encoded);
+        CHECK(encoded == "bW9jaw==");
+        std::vector<uint8_t> decoded;
+        CHECK(!Base64Decode("bW9j*w==", decoded));
+        CHECK(Base64Decode("", decoded) && decoded.empty());
+    }
+}
+
+int main()
+{
+    TestFrameRoundTrip();
+    TestMalformedHeaders();
+    TestOversizeEncode();
+    TestCommandWithState();
+    TestBase64();
+    return TEST_RESULT();
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "Ipc_Transport.h"
+#include "Shared_Layout.h"
+
+extern char **environ;
+
+// =================================================================
+// テストとベンチマーク用の Mock_Host クライアント (POSIX)
+// =================================================================
+// Mock_Host を子プロセスとして起動し、プラグイン本体と同じ従来方式
+// (コマンドはパイプ、音声は AudioSharedData + float[4][2048]) で通信します。
+namespace mock_client
+{
+    constexpr int LEGACY_BLOCK_SIZE = 2048;
+    constexpr size_t LEGACY_SHARED_SIZE = sizeof(AudioSharedData) + 4 * LEGACY_BLOCK_SIZE * sizeof(float);
+
+    class Host
+    {
+    public:
+        Host() = default;
+        Host(const Host &) = delete;
+        Host &operator=(const Host &) = delete;
+        ~Host() { Stop(); }
+
+        // extra_args は "-cost_us", "500" のようにキーと値を交互に並べたもの
+        bool Start(const std::string &exe, const std::vector<std::string> &extra_args, uint32_t timeout_ms = 5000)
+        {
+            static std::atomic<unsigned> counter = 0;
+            // Mock_Host は -uid を数値として読む
+            const std::string uid = std::to_string(static_cast<unsigned long long>(getpid()) * 10000 + counter++);
+            std::vector<std::string> args = {exe, "-uid", uid, "-pipe", "Local\\MockTestPipe", "-shm", "Local\\MockTestShm",
+                                             "-event_ready", "Local\\MockTestReady", "-event_done", "Local\\MockTestDone"};
+            args.insert(args.end(), extra_args.begin(), extra_args.end());
+            std::vector<char *> argv;
+            for (auto &arg : args)
+                argv.push_back(arg.data());
+            argv.push_back(nullptr);
+            if (posix_spawn(&pid, exe.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+            {
+                pid = -1;
+                return false;
+            }
+            // Mock_Host は共有メモリとイベントを作ってから接続を受け付けるので、最初の応答が届けば開ける
+            std::string response;
+            if (!pipe.Connect(("Local\\MockTestPipe_" + uid).c_str(), timeout_ms) || !Command("get_capabilities", response) ||
+                !shared.Open(("Local\\MockTestShm_" + uid).c_str(), LEGACY_SHARED_SIZE) ||
+                !ready.Open(("Local\\MockTestReady_" + uid).c_str()) || !done.Open(("Local\\MockTestDone_" + uid).c_str()))
+            {
+                Stop();
+                return false;
+            }
+            return true;
+        }
+
+        // 1行のコマンドを送り、改行までの応答を返す (改行は含まない)
+        bool Command(const std::string &command, std::string &response)
+        {
+            const std::string line = command + "\n";
+            if (!pipe.Write(line.data(), line.size()))
+                return false;
+            response.clear();
+            char c;
+            while (pipe.Read(&c, 1))
+            {
+                if (c == '\n')
+                    return true;
+                response.push_back(c);
+            }
+            return false;
+        }
+
+        // ステレオ1ブロック分を従来方式で往復させる
+        bool ProcessBlock(const float *in_l, const float *in_r, float *out_l, float *out_r, int samples, uint32_t timeout_ms)
+        {
+            auto *data = static_cast<AudioSharedData *>(shared.Data());
+            auto *buffer = reinterpret_cast<float *>(data + 1);
+            samples = std::min(samples, LEGACY_BLOCK_SIZE);
+            data->sampleRate = 48000;
+            data->numSamples = samples;
+            data->numChannels = 2;
+            memcpy(buffer, in_l, samples * sizeof(float));
+            memcpy(buffer + LEGACY_BLOCK_SIZE, in_r, samples * sizeof(float));
+            done.Reset();
+            ready.Set();
+            if (done.Wait(timeout_ms) != ipc_transport::WaitResult::signaled)
+                return false;
+            memcpy(out_l, buffer + 2 * LEGACY_BLOCK_SIZE, samples * sizeof(float));
+            memcpy(out_r, buffer + 3 * LEGACY_BLOCK_SIZE, samples * sizeof(float));
+            return true;
+        }
+
+        // exit を送って終了を待ち、応答がなければ強制終了する
+        void Stop()
+        {
+            if (pid <= 0)
+                return;
+            if (pipe.IsOpen())
+            {
+                std::string response;
+                Command("exit", response);
+            }
+            pipe.Close();
+            int status = 0;
+            for (int i = 0; i < 200 && waitpid(pid, &status, WNOHANG) == 0; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (waitpid(pid, &status, WNOHANG) == 0)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+            }
+            pid = -1;
+            ready.Close();
+            done.Close();
+            shared.Close();
+        }
+
+        pid_t Pid() const { return pid; }
+
+    private:
+        pid_t pid = -1;
+        ipc_transport::Channel pipe;
+        ipc_transport::SharedMemory shared;
+        ipc_transport::Signal ready;
+        ipc_transport::Signal done;
+    };
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdio>
+
+// =================================================================
+// テスト用の最小限のマクロ
+// =================================================================
+// 失敗した CHECK を数え、TEST_RESULT() を main の戻り値にします (ctest は 0 以外を失敗とみなす)
+namespace test_util
+{
+    inline int g_failures = 0;
+}
+
+#define CHECK(condition)                                                                         \
+    do                                                                                           \
+    {                                                                                            \
+        if (!(condition))                                                                        \
+        {                                                                                        \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++test_util::g_failures;                                                             \
+        }                                                                                        \
+    } while (0)
+
+#define TEST_RESULT() (test_util::g_failures == 0 ? 0 : 1)
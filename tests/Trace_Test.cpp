@@ -0,0 +1,92 @@
+#include "Trace.h"
+#include "Test_Util.h"
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::string WriteTrace()
+    {
+        std::FILE *file = std::tmpfile();
+        if (!file)
+            return {};
+        CHECK(trace::WriteChromeTrace(file));
+        std::string text(static_cast<size_t>(std::ftell(file)), '\0');
+        std::rewind(file);
+        text.resize(std::fread(text.data(), 1, text.size(), file));
+        std::fclose(file);
+        return text;
+    }
+
+    size_t Count(const std::string &text, const char *pattern)
+    {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+            ++count;
+        return count;
+    }
+
+    void TestDisabled()
+    {
+        // Enable() の前の Span は何も記録しない
+        {
+            TRACE_SPAN("before_enable");
+        }
+        std::thread([]
+                    { trace::SetThreadName("disabled_thread"); })
+            .join();
+        const std::string text = WriteTrace();
+        CHECK(text.find("before_enable") == std::string::npos);
+        CHECK(text.find("disabled_thread") == std::string::npos);
+    }
+
+    void TestRecord()
+    {
+        trace::Enable();
+        std::thread([]
+                    {
+                        trace::SetThreadName("worker \"1\"");
+                        trace::Record("manual", 100, 25, 42);
+                        TRACE_SPAN("span_no_arg"); })
+            .join();
+        const std::string text = WriteTrace();
+        CHECK(text.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+        CHECK(text.find("\"name\":\"thread_name\",\"ph\":\"M\"") != std::string::npos);
+        // 名前の引用符はエスケープされる
+        CHECK(text.find("\"args\":{\"name\":\"worker \\\"1\\\"\"}") != std::string::npos);
+        CHECK(text.find("{\"name\":\"manual\",\"ph\":\"X\",\"pid\":1,\"tid\":") != std::string::npos);
+        CHECK(text.find("\"ts\":100,\"dur\":25,\"args\":{\"value\":42}}") != std::string::npos);
+        const size_t span = text.find("\"name\":\"span_no_arg\"");
+        CHECK(span != std::string::npos);
+        CHECK(span != std::string::npos && text.find("args", span) > text.find('}', span));
+        CHECK(Count(text, "dropped_events\",\"ph\"") == 0);
+        CHECK(text.find("\"otherData\":{\"dropped_events\":0}") != std::string::npos);
+    }
+
+    void TestOverflow()
+    {
+        const uint64_t dropped_before = trace::Dropped();
+        std::thread([]
+                    {
+                        for (uint32_t i = 0; i < trace::EVENTS_PER_THREAD + 5; ++i)
+                            trace::Record("fill", i, 1, trace::NO_ARG); })
+            .join();
+        CHECK(trace::Dropped() == dropped_before + 5);
+        const std::string text = WriteTrace();
+        CHECK(Count(text, "\"name\":\"fill\"") == trace::EVENTS_PER_THREAD);
+        // 溢れたスレッドには最後のイベントの終わりに件数付きの印が付く
+        const std::string marker = "\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"t\"";
+        CHECK(Count(text, marker.c_str()) == 1);
+        CHECK(text.find("\"ts\":" + std::to_string(trace::EVENTS_PER_THREAD) + ",\"args\":{\"count\":5}}") != std::string::npos);
+        CHECK(text.find("\"otherData\":{\"dropped_events\":" + std::to_string(dropped_before + 5) + "}") != std::string::npos);
+    }
+}
+
+int main()
+{
+    TestDisabled();
+    TestRecord();
+    TestOverflow();
+    return TEST_RESULT();
+}